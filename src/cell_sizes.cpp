@@ -0,0 +1,10 @@
+#include "cell_sizes.hpp"
+
+CellSizes::CellSizes(GeographicCoordinate origin, int rows) : origin(origin) {
+  areas.reserve(rows);
+  spacings.reserve(rows);
+  for (int row = 0; row < rows; row++) {
+    areas.push_back(find_area({row, 0}, origin));
+    spacings.push_back(find_orthogonal_nn_distance({row, 0}, {row, 1}, origin));
+  }
+}
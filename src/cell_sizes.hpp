@@ -0,0 +1,39 @@
+#ifndef CELL_SIZES_H
+#define CELL_SIZES_H
+
+#include "phes_base.h"
+
+// The area and east-west spacing of the cells in each row of a grid, as find_area and
+// find_orthogonal_nn_distance give them, so loops over the cells of a grid take a cosine for each
+// row rather than each cell. Both only depend on the latitude of the cell, so cells given with
+// another origin latitude, or outside the rows, fall back to those functions.
+class CellSizes {
+public:
+  CellSizes(GeographicCoordinate origin, int rows);
+
+  // Area of the cell in ha
+  double area(GridPoint p, GeographicCoordinate origin) {
+    if (in_table(p.row, origin))
+      return areas[p.row];
+    return find_area(p, origin);
+  }
+  double area(GridPoint p) { return area(p, origin); }
+
+  // Distance in m between orthogonal neighbours
+  double orthogonal_nn_distance(GridPoint p1, GridPoint p2, GeographicCoordinate origin) {
+    if (p1.row == p2.row && p1.col != p2.col && in_table(p1.row, origin))
+      return spacings[p1.row];
+    return find_orthogonal_nn_distance(p1, p2, origin);
+  }
+
+private:
+  bool in_table(int row, GeographicCoordinate origin) {
+    return origin.lat == this->origin.lat && row >= 0 && row < (int)areas.size();
+  }
+
+  GeographicCoordinate origin;
+  vector<double> areas;
+  vector<double> spacings; // Between neighbours along the row
+};
+
+#endif
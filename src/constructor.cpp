@@ -1,13 +1,14 @@
 #include "phes_base.h"
 #include "constructor_helpers.hpp"
+#include "country_index.hpp"
 #include "kml.h"
+#include "point_index.hpp"
+#include "stages.hpp"
 
-vector<vector<Pair>> pairs;
-
-bool model_existing_reservoir(Reservoir* reservoir, Reservoir_KML_Coordinates* coordinates, vector<vector<vector<GeographicCoordinate>>>& countries, vector<string>& country_names){
+bool model_existing_reservoir(Reservoir* reservoir, Reservoir_KML_Coordinates* coordinates, const CountryIndex *countries, const SearchParameters &params){
   if(!reservoir->river){
     ExistingReservoir r;
-    if (use_tiled_bluefield)
+    if (params.use_tiled_bluefield)
       r = get_existing_tiled_reservoir(reservoir->identifier, reservoir->latitude,
           reservoir->longitude);
     else
@@ -16,48 +17,41 @@ bool model_existing_reservoir(Reservoir* reservoir, Reservoir_KML_Coordinates* c
     string polygon_string = str(compress_poly(corner_cut_poly(r.polygon)), reservoir->pit ? r.elevation+reservoir->dam_height : r.elevation+5);
     coordinates->reservoir = polygon_string;
 
-    GeographicCoordinate origin = get_origin(r.latitude, r.longitude, border);
+    GeographicCoordinate origin = get_origin(r.latitude, r.longitude, params.border);
     reservoir->shape_bound.clear();
     for(GeographicCoordinate p : r.polygon)
       reservoir->shape_bound.push_back(convert_coordinates(p, origin));
 
     //KML
-    for(uint i = 0; i< countries.size();i++){
-        if(check_within(GeographicCoordinate_init(reservoir->latitude, reservoir->longitude), countries[i])){
-            reservoir->country = country_names[i];
-            break;
-        }
-    }
+    if(countries != NULL)
+        countries->find(GeographicCoordinate_init(reservoir->latitude, reservoir->longitude), reservoir->country);
   }
     return true;
 }
 
-bool model_pair(Pair *pair, Pair_KML *pair_kml, Model<bool> *seen,
-                bool *non_overlap, int max_FOM, BigModel big_model,
-                Model<char> *full_cur_model,
-                vector<vector<vector<GeographicCoordinate>>> &countries,
-                vector<string> &country_names) {
+// Models both reservoirs of a pair. Whether the pair overlaps the pairs before it is left to the
+// caller, which checks the cells in reached against seen and adds the pair's footprint if not.
+bool model_pair(Pair *pair, Pair_KML *pair_kml, Footprint *reached, Footprint *footprint,
+                int max_FOM, BigModel big_model,
+                const CountryIndex *countries, const SearchParameters &params) {
+  ScopedTimer timer("model_pair");
 
-  vector<ArrayCoordinate> used_points;
-  *non_overlap = true;
 
   if (pair->upper.brownfield) {
-    if (!model_existing_reservoir(&pair->upper, &pair_kml->upper, countries,
-                                  country_names))
+    if (!model_existing_reservoir(&pair->upper, &pair_kml->upper, countries, params))
       return false;
-  } else if (!model_reservoir(&pair->upper, &pair_kml->upper, seen, non_overlap,
-                              &used_points, big_model, full_cur_model,
-                              countries, country_names))
+  } else if (!model_reservoir(&pair->upper, &pair_kml->upper, NULL, reached,
+                              footprint, big_model,
+                              countries, params))
     return false;
 
   if (pair->lower.brownfield) {
-    if (!model_existing_reservoir(&pair->lower, &pair_kml->lower, countries,
-                                  country_names))
+    if (!model_existing_reservoir(&pair->lower, &pair_kml->lower, countries, params))
       return false;
   } else if (!pair->lower.ocean &&
-             !model_reservoir(&pair->lower, &pair_kml->lower, seen, non_overlap,
-                              &used_points, big_model, full_cur_model,
-                              countries, country_names))
+             !model_reservoir(&pair->lower, &pair_kml->lower, NULL, reached,
+                              footprint, big_model,
+                              countries, params))
     return false;
 
   pair->country = pair->upper.country;
@@ -65,33 +59,25 @@ bool model_pair(Pair *pair, Pair_KML *pair_kml, Model<bool> *seen,
   ArrayCoordinate upper_closest_point = pair->upper.pour_point;
   ArrayCoordinate lower_closest_point = pair->lower.pour_point;
   double mindist = find_distance(upper_closest_point, lower_closest_point);
-  for (ArrayCoordinate u_bound : pair->upper.shape_bound)
-    for (ArrayCoordinate l_bound : pair->lower.shape_bound)
-      if (find_distance(u_bound, l_bound) < mindist) {
-        upper_closest_point = u_bound;
-        lower_closest_point = l_bound;
-        mindist = find_distance(u_bound, l_bound);
-      }
+  PointIndex lower_bound(pair->lower.shape_bound);
+  for (ArrayCoordinate u_bound : pair->upper.shape_bound) {
+    int l = lower_bound.closest(u_bound, mindist);
+    if (l >= 0) {
+      upper_closest_point = u_bound;
+      lower_closest_point = pair->lower.shape_bound[l];
+    }
+  }
 
   pair->distance = mindist;
   pair->slope = pair->head / (pair->distance * 1000);
   pair->volume = min(pair->upper.volume, pair->lower.volume);
   pair->water_rock =
       1 / ((1 / pair->upper.water_rock) + (1 / pair->lower.water_rock));
-  set_FOM(pair);
+  set_FOM(pair, params);
   if (pair->FOM > max_FOM || pair->category == 'Z') {
     return false;
   }
 
-  if (*non_overlap) {
-    for (uint i = 0; i < used_points.size(); i++) {
-      seen->set(used_points[i].row, used_points[i].col, true);
-    }
-    pair->non_overlap = 1;
-  } else {
-    pair->non_overlap = 0;
-  }
-
     GeographicCoordinate average = GeographicCoordinate_init((convert_coordinates(upper_closest_point).lat+convert_coordinates(lower_closest_point).lat)/2,
     	((convert_coordinates(upper_closest_point).lon+convert_coordinates(lower_closest_point).lon)/2));
     pair_kml->point = dtos(average.lon,5)+","+dtos(average.lat,5)+",0";
@@ -99,18 +85,72 @@ bool model_pair(Pair *pair, Pair_KML *pair_kml, Model<bool> *seen,
 	return true;
 }
 
-int main(int nargs, char **argv)
-{
-    search_config = SearchConfig(nargs, argv);
+// A pair modelled before it is checked for overlap with the pairs before it
+struct ModelledPair {
+  bool modelled;
+  Pair_KML kml;
+  Footprint reached;
+  Footprint footprint;
+};
 
-    cout << "Constructor started for " << search_config.filename() << endl;
+// Pairs each thread models ahead of the pairs being added to seen. The modelled pairs hold their
+// footprints and KML until written, so this bounds the memory used.
+const uint look_ahead_per_thread = 32;
 
-    GDALAllRegister();
-    parse_variables(convert_string("storage_location"));
-    parse_variables(convert_string(file_storage_location+"variables"));
-    unsigned long t_usec = walltime_usec();
+// Number of pairs of a test to model before adding them to seen, 1 when modelling on one thread
+static uint model_window() {
+  uint nthreads = MAX(stage_threads, 1);
+  return nthreads > 1 ? nthreads * look_ahead_per_thread : 1;
+}
 
-    pairs = read_rough_pair_data(convert_string(file_storage_location+"processing_files/pretty_set_pairs/"+search_config.filename()+"_rough_pretty_set_pairs_data.csv"));
+// Models pairs begin to end - 1 of a test on stage_threads threads. Only the check for overlap
+// depends on the pairs before, so the pairs can be modelled in any order.
+static vector<ModelledPair> model_pairs(vector<Pair> &pairs, uint begin, uint end, int max_FOM,
+                                        BigModel &big_model, const CountryIndex *countries,
+                                        const SearchParameters &params) {
+  vector<ModelledPair> modelled(end - begin);
+  uint nthreads = MIN((uint)MAX(stage_threads, 1), end - begin);
+  atomic<uint> next_pair(begin);
+  auto model_next = [&]() {
+    for (uint j = next_pair++; j < end; j = next_pair++) {
+      ModelledPair &m = modelled[j - begin];
+      m.modelled = model_pair(&pairs[j], &m.kml, &m.reached, &m.footprint, max_FOM, big_model,
+                              countries, params);
+    }
+  };
+  if (nthreads <= 1) {
+    model_next();
+    return modelled;
+  }
+
+  SearchConfig config = search_config;
+  vector<Metrics> thread_metrics(nthreads);
+  vector<exception_ptr> errors(nthreads);
+  vector<thread> threads;
+  for (uint t = 0; t < nthreads; t++)
+    threads.push_back(thread([&, t]() {
+      search_config = config;
+      try {
+        model_next();
+      } catch (...) {
+        errors[t] = current_exception();
+      }
+      thread_metrics[t] = metrics;
+    }));
+  for (uint t = 0; t < nthreads; t++) {
+    threads[t].join();
+    metrics.add(thread_metrics[t]);
+  }
+  for (uint t = 0; t < nthreads; t++)
+    if (errors[t])
+      rethrow_exception(errors[t]);
+  return modelled;
+}
+
+int construct_pairs(vector<vector<Pair>> &pairs, BigModel *given_big_model, const SearchParameters &params)
+{
+    ScopedTimer timer("construct_pairs");
+    unsigned long t_usec = walltime_usec();
 
     mkdir(convert_string(file_storage_location+"output/final_output_classes"), 0777);
     mkdir(convert_string(file_storage_location+"output/final_output_classes/"+search_config.filename()),0777);
@@ -127,16 +167,19 @@ int main(int nargs, char **argv)
 		total_pairs += pairs[i].size();
 
 	if (total_pairs == 0) {
-        for(uint i = 0; i<tests.size(); i++){
-            write_summary_csv(total_csv_file_classes, str(search_config.grid_square), str(tests[i]),
+        for(uint i = 0; i<params.tests.size(); i++){
+            write_summary_csv(total_csv_file_classes, str(search_config.grid_square), str(params.tests[i]),
                                 0, 0, 0);
-            write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), str(tests[i]),
+            write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), str(params.tests[i]),
                                 0, 0, 0);
         }
         write_summary_csv(total_csv_file_classes, str(search_config.grid_square), "TOTAL", 0, -1, 0);
         write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), "TOTAL", 0, -1, 0);
+        count_file_written(total_csv_file_classes);
+        count_file_written(total_csv_file_FOM);
         fclose(total_csv_file_classes);
         fclose(total_csv_file_FOM);
+        search_config.logger.flush();
         cout << "Constructor finished for " << convert_string(search_config.filename()) << ". Found no pairs. Runtime: " << 1.0e-6*(walltime_usec() - t_usec) << " sec" << endl;
         return 0;
     }
@@ -144,71 +187,96 @@ int main(int nargs, char **argv)
     if(search_config.search_type.single())
         search_config.grid_square = get_square_coordinate(get_existing_reservoir(search_config.name));
 
-    BigModel big_model = BigModel_init(search_config.grid_square);
-    vector<string> country_names;
-    vector<vector<vector<GeographicCoordinate>>> countries = read_countries(file_storage_location+"input/countries/countries.txt", country_names);
+    BigModel big_model = given_big_model ? *given_big_model : BigModel_init(search_config.grid_square);
+    shared_ptr<const CountryIndex> countries = CountryIndex::load(file_storage_location+"input/countries/countries.txt");
 
-    Model<bool>* seen = new Model<bool>(big_model.DEM->nrows(), big_model.DEM->nrows(), MODEL_SET_ZERO);
+    Occupancy* seen = new Occupancy(big_model.DEM->nrows(), big_model.DEM->ncols());
     seen->set_geodata(big_model.DEM->get_geodata());
-    Model<char>* full_cur_model = new Model<char>(big_model.DEM->nrows(), big_model.DEM->ncols(), MODEL_SET_ZERO);
-    full_cur_model->set_geodata(big_model.DEM->get_geodata());
 
     int total_count = 0;
     int total_capacity = 0;
-    for(uint i = 0; i<tests.size(); i++){
+    for(uint i = 0; i<params.tests.size(); i++){
       int count = 0;
       int non_overlapping_count = 0;
       if (pairs[i].size() != 0) {
-        FILE *csv_file_classes = fopen(convert_string(file_storage_location+"output/final_output_classes/"+search_config.filename()+"/"+search_config.filename()+"_"+str(tests[i])+".csv"), "w");
+        FILE *csv_file_classes = fopen(convert_string(file_storage_location+"output/final_output_classes/"+search_config.filename()+"/"+search_config.filename()+"_"+str(params.tests[i])+".csv"), "w");
         write_pair_csv_header(csv_file_classes, false);
-        FILE *csv_file_FOM = fopen(convert_string(file_storage_location+"output/final_output_FOM/"+search_config.filename()+"/"+search_config.filename()+"_"+str(tests[i])+".csv"), "w");
+        FILE *csv_file_FOM = fopen(convert_string(file_storage_location+"output/final_output_FOM/"+search_config.filename()+"/"+search_config.filename()+"_"+str(params.tests[i])+".csv"), "w");
         write_pair_csv_header(csv_file_FOM, true);
 
-        ofstream kml_file_classes(convert_string(file_storage_location+"output/final_output_classes/"+search_config.filename()+"/"+search_config.filename()+"_"+str(tests[i])+".kml"), ios::out);
-        ofstream kml_file_FOM(convert_string(file_storage_location+"output/final_output_FOM/"+search_config.filename()+"/"+search_config.filename()+"_"+str(tests[i])+".kml"), ios::out);
-        KML_Holder kml_holder;
+        KML_Writer kml_writer({file_storage_location+"output/final_output_classes/"+search_config.filename()+"/"+search_config.filename()+"_"+str(params.tests[i])+".kml",
+                               file_storage_location+"output/final_output_FOM/"+search_config.filename()+"/"+search_config.filename()+"_"+str(params.tests[i])+".kml"},
+                              search_config.filename(), params.tests[i]);
 
         sort(pairs[i].begin(), pairs[i].end());
 	    set<string> lowers;
         set<string> uppers;
         bool keep_lower;
         bool keep_upper;
-        for(uint j=0; j<pairs[i].size(); j++){
-            Pair_KML pair_kml;
-            bool non_overlap;
-            int max_FOM = category_cutoffs[0].storage_cost*tests[i].storage_time+category_cutoffs[0].power_cost;
-            if(model_pair(&pairs[i][j], &pair_kml, seen, &non_overlap, max_FOM, big_model, full_cur_model, countries, country_names)){
+        int max_FOM = params.category_cutoffs[0].storage_cost*params.tests[i].storage_time+params.category_cutoffs[0].power_cost;
+        // The pairs are modelled a window at a time, and added to seen in FOM order, as when
+        // modelled one at a time
+        uint window = model_window();
+        for(uint begin=0; begin<pairs[i].size(); begin+=window){
+          uint end = MIN(begin+window, (uint)pairs[i].size());
+          vector<ModelledPair> modelled = model_pairs(pairs[i], begin, end, max_FOM, big_model, countries.get(), params);
+          for(uint j=begin; j<end; j++){
+            if(modelled[j-begin].modelled){
+                bool non_overlap = !seen->overlaps(modelled[j-begin].reached);
+                if(non_overlap)
+                    seen->add(modelled[j-begin].footprint);
+                pairs[i][j].non_overlap = non_overlap;
                 write_pair_csv(csv_file_classes, &pairs[i][j], false);
                 write_pair_csv(csv_file_FOM, &pairs[i][j], true);
                 keep_lower = !lowers.contains(pairs[i][j].lower.identifier);
                 keep_upper = !uppers.contains(pairs[i][j].upper.identifier);
                 lowers.insert(pairs[i][j].lower.identifier);
                 uppers.insert(pairs[i][j].upper.identifier);
-                update_kml_holder(&kml_holder, &pairs[i][j], &pair_kml, keep_upper, keep_lower);
+                kml_writer.add(&pairs[i][j], &modelled[j-begin].kml, keep_upper, keep_lower);
                 count++;
                 if(non_overlap){
                     non_overlapping_count++;
                     total_count++;
-                    total_capacity+=tests[i].energy_capacity;
+                    total_capacity+=params.tests[i].energy_capacity;
                 }
             }
+          }
         }
-        kml_file_classes << output_kml(&kml_holder, search_config.filename(), tests[i]);
-        kml_file_FOM << output_kml(&kml_holder, search_config.filename(), tests[i]);
-        search_config.logger.debug(to_string(count) + " " + to_string(tests[i].energy_capacity) + "GWh "+to_string(tests[i].storage_time) + "h Pairs");
-        kml_file_classes.close();
-        kml_file_FOM.close();
+        kml_writer.close();
+        search_config.logger.debug(to_string(count) + " " + to_string(params.tests[i].energy_capacity) + "GWh "+to_string(params.tests[i].storage_time) + "h Pairs");
+        count_file_written(csv_file_classes);
+        count_file_written(csv_file_FOM);
         fclose(csv_file_classes);
         fclose(csv_file_FOM);
       }
-      write_summary_csv(total_csv_file_classes, str(search_config.grid_square), str(tests[i]),
-                        non_overlapping_count, count, count*tests[i].energy_capacity);
-      write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), str(tests[i]),
-                        non_overlapping_count, count, count*tests[i].energy_capacity);
+      write_summary_csv(total_csv_file_classes, str(search_config.grid_square), str(params.tests[i]),
+                        non_overlapping_count, count, count*params.tests[i].energy_capacity);
+      write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), str(params.tests[i]),
+                        non_overlapping_count, count, count*params.tests[i].energy_capacity);
     }
     write_summary_csv(total_csv_file_classes, str(search_config.grid_square), "TOTAL", total_count, -1, total_capacity);
     write_summary_csv(total_csv_file_FOM, str(search_config.grid_square), "TOTAL", total_count, -1, total_capacity);
+    count_file_written(total_csv_file_classes);
+    count_file_written(total_csv_file_FOM);
     fclose(total_csv_file_classes);
     fclose(total_csv_file_FOM);
+    delete seen;
+    if (!given_big_model)
+        BigModel_free(big_model);
+    search_config.logger.flush();
     cout << "Constructor finished for " << convert_string(search_config.filename()) << ". Found " << total_count << " non-overlapping pairs with a total of " << total_capacity << "GWh. Runtime: " << 1.0e-6*(walltime_usec() - t_usec) << " sec" << endl;
+    return 0;
+}
+
+int run_constructor()
+{
+    search_config.logger.set_stage("constructor");
+    metrics.reset();
+    cout << "Constructor started for " << search_config.filename() << endl;
+    const SearchParameters params = SearchParameters::from_variables();
+
+    vector<vector<Pair>> pairs = read_rough_pair_data(convert_string(file_storage_location+"processing_files/pretty_set_pairs/"+search_config.filename()+"_rough_pretty_set_pairs_data.csv"));
+    int result = construct_pairs(pairs, NULL, params);
+    write_metrics("constructor");
+    return result;
 }
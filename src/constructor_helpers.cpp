@@ -1,4 +1,8 @@
 #include "constructor_helpers.hpp"
+#include "cell_sizes.hpp"
+#include "country_index.hpp"
+#include "reservoir_cache.hpp"
+#include "scratch.hpp"
 
 /*
  * Returns sorted vector containing the longitude of all polgon boundary interections at certain
@@ -91,7 +95,7 @@ ArrayCoordinate *get_adjacent_cells(ArrayCoordinate point1, ArrayCoordinate poin
 /*
  * Determine if two points define an edge of a reservoir given its raster model
  */
-bool is_edge(ArrayCoordinate point1, ArrayCoordinate point2, Model<char>* model, ArrayCoordinate offset, int threshold){
+bool is_edge(GridPoint point1, GridPoint point2, Model<char>* model, ArrayCoordinate offset, int threshold){
 
     if (point1.row+offset.row<0 || point1.col+offset.col<0 || point1.row+offset.row>model->nrows() || point1.col+offset.col>model->ncols())
         return false;
@@ -102,7 +106,8 @@ bool is_edge(ArrayCoordinate point1, ArrayCoordinate point2, Model<char>* model,
     point2.row += offset.row;
     point1.col += offset.col;
     point2.col += offset.col;
-    ArrayCoordinate* to_check = get_adjacent_cells(point1, point2);
+    ArrayCoordinate* to_check = get_adjacent_cells(ArrayCoordinate_init(point1, offset.origin),
+                                                   ArrayCoordinate_init(point2, offset.origin));
 
     if((!model->check_within(to_check[0].row,to_check[0].col) && model->get(to_check[1].row,to_check[1].col)>=threshold)||
         (!model->check_within(to_check[1].row,to_check[1].col) && model->get(to_check[0].row,to_check[0].col)>=threshold))
@@ -145,27 +150,28 @@ int testsa[] = {1, 2, 0, 3};
 // FIXME threshold should be same type as model
 vector<ArrayCoordinate> convert_to_polygon(Model<char>* model, ArrayCoordinate offset, ArrayCoordinate pour_point, int threshold){
 
-    vector<ArrayCoordinate> to_return;
+    vector<GridPoint> path;
 
-    ArrayCoordinate test_coordinates[] = {
-        ArrayCoordinate_init(pour_point.row+1, pour_point.col+1, pour_point.origin),
-        ArrayCoordinate_init(pour_point.row+1, pour_point.col, pour_point.origin),
-        ArrayCoordinate_init(pour_point.row, pour_point.col, pour_point.origin),
-        ArrayCoordinate_init(pour_point.row, pour_point.col+1, pour_point.origin)};
+    GridPoint test_coordinates[] = {
+        {pour_point.row+1, pour_point.col+1},
+        {pour_point.row+1, pour_point.col},
+        {pour_point.row, pour_point.col},
+        {pour_point.row, pour_point.col+1}};
 
     bool succesful_path = false;
+    vector<GridPoint> temp_to_return;
     for(int i = 0; i<4; i++){
-        vector<ArrayCoordinate> temp_to_return;
+        temp_to_return.clear();
         int last_dir = testsa[i];
-        ArrayCoordinate initial = test_coordinates[i];
-        ArrayCoordinate last = initial;
+        GridPoint initial = test_coordinates[i];
+        GridPoint last = initial;
         bool found_path;
 
         while(true){
             found_path = false;
             for(int id = 0; id<3; id++){
                 int d = dir_to_do[last_dir][id];
-                ArrayCoordinate next = ArrayCoordinate_init(last.row+dir_def[d][0],last.col+dir_def[d][1], pour_point.origin);
+                GridPoint next = {last.row+dir_def[d][0], last.col+dir_def[d][1]};
                 if(is_edge(last, next, model, offset, threshold)){
                     temp_to_return.push_back(next);
                     last = next;
@@ -181,12 +187,8 @@ vector<ArrayCoordinate> convert_to_polygon(Model<char>* model, ArrayCoordinate o
                 break;
             }
         }
-        if(temp_to_return.size()>to_return.size()){
-            to_return.clear();
-            for(uint j = 0; j<temp_to_return.size(); j++){
-                to_return.push_back(temp_to_return[j]);
-            }
-        }
+        if(temp_to_return.size()>path.size())
+            path.swap(temp_to_return);
     }
     if(!succesful_path){
       search_config.logger.error("Could not find a succesful path around the polygon.");
@@ -195,6 +197,10 @@ vector<ArrayCoordinate> convert_to_polygon(Model<char>* model, ArrayCoordinate o
       model->write(to_string(threshold)+"dump.tif", GDT_Byte);
       throw 1;
     }
+    vector<ArrayCoordinate> to_return;
+    to_return.reserve(path.size());
+    for(GridPoint p : path)
+        to_return.push_back(ArrayCoordinate_init(p, pour_point.origin));
     return to_return;
 }
 
@@ -249,24 +255,307 @@ string str(vector<GeographicCoordinate> polygon, double elevation) {
   return to_return;
 }
 
+/*
+ * Flood from the pour point up to top_height, recording the cells in the order they are reached
+ */
+static shared_ptr<ReservoirFlood> record_flood(GridPoint pour_point, GeographicCoordinate origin,
+                                               double top_height, BigModel &big_model,
+                                               Model<char> *flow_directions,
+                                               CellSizes *cell_sizes, ArrayCoordinate offset,
+                                               ArrayCoordinate reservoir_big_ac) {
+  Model<short> *DEM = big_model.DEM;
+  long &cells_flooded = metrics.counters[CELLS_FLOODED];
+  shared_ptr<ReservoirFlood> recorded = make_shared<ReservoirFlood>();
+  recorded->top_height = top_height;
+  recorded->lowest_level = INT_MAX;
+  recorded->first_void = INT_MAX;
+  vector<FloodCell> &flood = recorded->cells;
+  int pour_point_elevation = DEM->get(reservoir_big_ac.row, reservoir_big_ac.col);
+
+  flood.push_back({pour_point, 0, INT_MIN});
+  for (size_t i = 0; i < flood.size(); i++) {
+    GridPoint p = flood[i].point;
+    GridPoint full_big_ac = {p.row + offset.row, p.col + offset.col};
+    cells_flooded++;
+
+    FloodCell &cell = flood[i];
+    cell.elevation = DEM->get(full_big_ac.row, full_big_ac.col) - pour_point_elevation;
+    cell.void_cell = DEM->get(full_big_ac.row, full_big_ac.col) < -2000;
+    cell.big_area = big_model.DEM_cell_sizes->area(full_big_ac, DEM->get_origin());
+    cell.area = cell_sizes->area(p, origin);
+    if (i > 0)
+      recorded->lowest_level = MIN(recorded->lowest_level, cell.path_max);
+    if (cell.void_cell)
+      recorded->first_void = MIN(recorded->first_void, cell.path_max);
+
+    for (uint d = 0; d < directions.size(); d++) {
+      GridPoint neighbor = {p.row + directions[d].row, p.col + directions[d].col};
+      if (!flow_directions->check_within(neighbor.row, neighbor.col) ||
+          !flow_directions->flows_to(neighbor, p))
+        continue;
+      int elevation =
+          DEM->get(neighbor.row + offset.row, neighbor.col + offset.col) - pour_point_elevation;
+      if (elevation < top_height)
+        flood.push_back({neighbor, elevation, MAX(flood[i].path_max, elevation)});
+    }
+  }
+
+  // Running totals of the cells by path_max
+  vector<FloodLevel> &levels = recorded->levels;
+  if (flood.size() > 1) {
+    int highest = INT_MIN;
+    for (size_t i = 1; i < flood.size(); i++)
+      highest = MAX(highest, flood[i].path_max);
+    levels.assign(highest - recorded->lowest_level + 1, {0, 0, 0});
+    for (size_t i = 1; i < flood.size(); i++) {
+      FloodLevel &level = levels[flood[i].path_max - recorded->lowest_level];
+      level.big_area += flood[i].big_area;
+      level.elevation_area += flood[i].elevation * flood[i].big_area;
+      level.abs_elevation_area += abs(flood[i].elevation) * flood[i].big_area;
+    }
+    for (size_t i = 1; i < levels.size(); i++) {
+      levels[i].big_area += levels[i - 1].big_area;
+      levels[i].elevation_area += levels[i - 1].elevation_area;
+      levels[i].abs_elevation_area += levels[i - 1].abs_elevation_area;
+    }
+  }
+
+  // Runs of the cells along the rows
+  vector<uint> &order = recorded->order;
+  order.resize(flood.size());
+  for (uint i = 0; i < flood.size(); i++)
+    order[i] = i;
+  sort(order.begin(), order.end(), [&](uint a, uint b) {
+    return flood[a].point.row < flood[b].point.row ||
+           (flood[a].point.row == flood[b].point.row && flood[a].point.col < flood[b].point.col);
+  });
+  for (uint i = 0; i < order.size(); i++) {
+    GridPoint p = flood[order[i]].point;
+    vector<FloodRun> &runs = recorded->runs;
+    if (!runs.empty() && runs.back().run.row == p.row && runs.back().run.end == p.col)
+      runs.back().run.end++;
+    else
+      runs.push_back({{p.row, p.col, p.col + 1}, i});
+  }
+  return recorded;
+}
+
+/*
+ * A flood of the reservoir up to at least dam_height, from the cache if an earlier one reached
+ * that high, otherwise recorded up to top_height and added to the cache
+ */
+static shared_ptr<const ReservoirFlood> find_flood(Reservoir *reservoir, GridPoint pour_point,
+                                                   double dam_height, double top_height,
+                                                   BigModel &big_model,
+                                                   Model<char> *flow_directions,
+                                                   CellSizes *cell_sizes, ArrayCoordinate offset,
+                                                   ArrayCoordinate reservoir_big_ac) {
+  ReservoirCache *cache = big_model.reservoir_cache;
+  if (cache != NULL) {
+    shared_ptr<const ReservoirFlood> flood =
+        cache->find(reservoir->identifier, pour_point, dam_height);
+    if (flood)
+      return flood;
+  }
+  shared_ptr<const ReservoirFlood> flood =
+      record_flood(pour_point, reservoir->pour_point.origin, top_height, big_model,
+                   flow_directions, cell_sizes, offset, reservoir_big_ac);
+  if (cache != NULL)
+    cache->insert(reservoir->identifier, pour_point, flood);
+  return flood;
+}
+
+/*
+ * The indices of the flood cells that have been used by another reservoir, in flood order
+ */
+static vector<uint> find_seen_cells(const ReservoirFlood &flood, Occupancy *seen,
+                                    ArrayCoordinate offset) {
+  vector<uint> seen_cells;
+  if (seen == NULL)
+    return seen_cells;
+  for (const FloodRun &flood_run : flood.runs) {
+    Run run = {flood_run.run.row + offset.row, flood_run.run.start + offset.col,
+               flood_run.run.end + offset.col};
+    seen->for_each_overlap(run, [&](int start, int end) {
+      for (int col = start; col < end; col++)
+        seen_cells.push_back(flood.order[flood_run.first + col - run.start]);
+    });
+  }
+  sort(seen_cells.begin(), seen_cells.end());
+  return seen_cells;
+}
+
+/*
+ * The lowest path_max of a cell that stops the modelling, which is a void cell or a cell that has
+ * been used by another reservoir
+ */
+static int find_first_fail(const ReservoirFlood &flood, vector<uint> &seen_cells) {
+  int first_fail = flood.first_void;
+  for (uint i : seen_cells)
+    first_fail = MIN(first_fail, flood.cells[i].path_max);
+  return first_fail;
+}
+
+/*
+ * Estimate the volume at a dam height from the totals by path_max. The volume summed cell by cell
+ * differs from the estimate by no more than error, as both only differ from the true sum by rounding.
+ */
+static double estimate_volume(double dam_height, const ReservoirFlood &flood, double &error) {
+  const FloodCell &pour_point = flood.cells[0];
+  double big_area = pour_point.big_area;
+  double elevation_area = pour_point.elevation * pour_point.big_area;
+  double abs_elevation_area = abs(pour_point.elevation) * pour_point.big_area;
+  const vector<FloodLevel> &levels = flood.levels;
+  long level = (long)ceil(dam_height) - 1 - flood.lowest_level;
+  if (level >= 0 && !levels.empty()) {
+    const FloodLevel &totals = levels[MIN(level, (long)levels.size() - 1)];
+    big_area += totals.big_area;
+    elevation_area += totals.elevation_area;
+    abs_elevation_area += totals.abs_elevation_area;
+  }
+  error = 8 * (flood.cells.size() + 4) * DBL_EPSILON *
+          (fabs(dam_height) * big_area + abs_elevation_area) / 100;
+  return (dam_height * big_area - elevation_area) / 100;
+}
+
+/*
+ * Sum the volume and area at a dam height cell by cell, in the order of a flood to that height,
+ * stopping before the cell at index end
+ */
+static void sum_flood(const ReservoirFlood &recorded, double dam_height, size_t end,
+                      double &volume, double &area) {
+  const vector<FloodCell> &flood = recorded.cells;
+  volume = 0;
+  area = 0;
+  for (size_t i = 0; i < end; i++)
+    if (flood[i].path_max < dam_height) {
+      volume += (dam_height - flood[i].elevation) * flood[i].big_area / 100;
+      area += flood[i].area;
+    }
+}
+
+/*
+ * Mark the cells reached by the floods up to each dam height tried, which are those below the
+ * highest, in the reservoir model and add them to reached
+ */
+static void mark_reached(const ReservoirFlood &recorded, double top, ArrayCoordinate offset,
+                         Footprint *reached) {
+  const vector<FloodCell> &flood = recorded.cells;
+  for (uint i : recorded.order)
+    if (flood[i].path_max < top)
+      reached->add(flood[i].point.row + offset.row, flood[i].point.col + offset.col);
+}
+
+/*
+ * A raster of the cells reached by the floods up to top set to 1, covering their bounding box and
+ * a border wide enough to trace around them and their dam walls. The raster is kept on the thread
+ * and only the part used is zeroed. model_offset takes cells of the flood to the raster as offset
+ * takes them to the DEM, and the raster's origin is set so it lines up with the DEM.
+ */
+static Model<char> *reservoir_raster(const ReservoirFlood &recorded, double top,
+                                     Model<short> *DEM, ArrayCoordinate offset,
+                                     ArrayCoordinate &model_offset) {
+  const int border = 2;
+  int min_row = INT_MAX, min_col = INT_MAX, max_row = INT_MIN, max_col = INT_MIN;
+  for (const FloodCell &cell : recorded.cells)
+    if (cell.path_max < top) {
+      min_row = MIN(min_row, cell.point.row);
+      max_row = MAX(max_row, cell.point.row);
+      min_col = MIN(min_col, cell.point.col);
+      max_col = MAX(max_col, cell.point.col);
+    }
+  int rows = max_row - min_row + 1 + 2 * border;
+  int cols = max_col - min_col + 1 + 2 * border;
+
+  unique_ptr<Model<char>> &raster = scratch.reservoir_raster;
+  if (!raster || raster->nrows() < rows || raster->ncols() < cols)
+    raster.reset(new Model<char>(MAX(rows, raster ? raster->nrows() : 0),
+                                 MAX(cols, raster ? raster->ncols() : 0), MODEL_UNSET));
+  for (int row = 0; row < rows; row++)
+    memset(raster->get_pointer(row, 0), 0, cols);
+
+  model_offset = offset;
+  model_offset.row = border - min_row;
+  model_offset.col = border - min_col;
+  Geodata geodata = DEM->get_geodata();
+  geodata.geotransform[3] += (offset.row - model_offset.row) * geodata.geotransform[5];
+  geodata.geotransform[0] += (offset.col - model_offset.col) * geodata.geotransform[1];
+  raster->set_geodata(geodata);
+
+  for (const FloodCell &cell : recorded.cells)
+    if (cell.path_max < top)
+      raster->set(cell.point.row + model_offset.row, cell.point.col + model_offset.col, 1);
+  return raster.get();
+}
+
+/*
+ * Update the shape bound as the floods up to each of the dam heights in turn would have. In each
+ * direction the bound is the first cell reached that is furthest in that direction, so it comes
+ * from the first of the floods to reach that far.
+ */
+static void update_shape_bound(const ReservoirFlood &recorded,
+                               vector<ArrayCoordinate> &shape_bound, vector<double> &heights) {
+  const vector<FloodCell> &flood = recorded.cells;
+  if (shape_bound.size() < directions.size())
+    return;
+  double top = *max_element(heights.begin(), heights.end());
+  for (uint d = 0; d < directions.size(); d++) {
+    int bound = directions[d].row * shape_bound[d].row + directions[d].col * shape_bound[d].col;
+    int furthest = bound;
+    int reach = INT_MAX;
+    for (const FloodCell &cell : flood) {
+      if (cell.path_max >= top)
+        continue;
+      int distance = directions[d].row * cell.point.row + directions[d].col * cell.point.col;
+      if (distance > furthest) {
+        furthest = distance;
+        reach = cell.path_max;
+      } else if (distance == furthest && furthest > bound) {
+        reach = MIN(reach, cell.path_max);
+      }
+    }
+    if (furthest == bound)
+      continue;
+    double first_height = top;
+    for (double h : heights)
+      if (reach < h) {
+        first_height = h;
+        break;
+      }
+    for (const FloodCell &cell : flood)
+      if (cell.path_max < first_height &&
+          directions[d].row * cell.point.row + directions[d].col * cell.point.col == furthest) {
+        shape_bound[d].row = cell.point.row;
+        shape_bound[d].col = cell.point.col;
+        break;
+      }
+  }
+}
+
 /*
  * Accurately model a single reservoir, determining optimal dam wall height for given volume.
  *
  * Pass negative reservoir volume to model single dam wall height
+ *
+ * Fails if the reservoir reaches a cell in seen. The cells reached by the floods tried are added
+ * to reached, so they can be checked for overlap later, and the cells of the reservoir to footprint.
  */
 bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinates,
-                     Model<bool> *seen, bool *non_overlap, vector<ArrayCoordinate> *used_points,
-                     BigModel big_model, Model<char> *full_cur_model,
-                     vector<vector<vector<GeographicCoordinate>>> &countries,
-                     vector<string> &country_names) {
+                     Occupancy *seen, Footprint *reached, Footprint *footprint,
+                     BigModel big_model,
+                     const CountryIndex *countries, const SearchParameters &params) {
+  metrics.count(RESERVOIRS_MODELLED);
 
   Model<short> *DEM = big_model.DEM;
   Model<char> *flow_directions = big_model.flow_directions[0];
+  CellSizes *cell_sizes = big_model.cell_sizes[0];
 
   for (int i = 0; i < 9; i++)
     if (big_model.neighbors[i].lat == convert_to_int(FLOOR(reservoir->latitude + EPS)) &&
-        big_model.neighbors[i].lon == convert_to_int(FLOOR(reservoir->longitude + EPS)))
+        big_model.neighbors[i].lon == convert_to_int(FLOOR(reservoir->longitude + EPS))) {
       flow_directions = big_model.flow_directions[i];
+      cell_sizes = big_model.cell_sizes[i];
+    }
 
   ArrayCoordinate offset = convert_coordinates(
       convert_coordinates(ArrayCoordinate_init(0, 0, flow_directions->get_origin())),
@@ -278,96 +567,108 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
   double req_volume = reservoir->volume;
   reservoir->volume = 0;
   reservoir->area = 0;
-  vector<ArrayCoordinate> temp_used_points;
+  GridPoint pour_point = {reservoir->pour_point.row, reservoir->pour_point.col};
 
   // RESERVOIR
+  // The dam height is stepped up or down until the volume is close enough, with each height giving
+  // the same volume as a flood to that height. A single flood up to the first height is recorded,
+  // and only flooded again, twice as far above the first height, if the steps go above it. The
+  // floods are kept in the big model's cache, so later pairs with this reservoir can reuse them.
+  double first_height = reservoir->dam_height;
+  shared_ptr<const ReservoirFlood> flood =
+      find_flood(reservoir, pour_point, first_height, first_height, big_model, flow_directions,
+                 cell_sizes, offset, reservoir_big_ac);
+  vector<uint> seen_cells = find_seen_cells(*flood, seen, offset);
+  int first_fail = find_first_fail(*flood, seen_cells);
+  vector<double> heights;
+  bool too_low, too_high, empty;
   char last_dir = 'd';
-  while ((req_volume > 0 &&
-          (reservoir->volume * (1 + 0.5 / reservoir->water_rock) <
-               (1 - volume_accuracy) * req_volume ||
-           reservoir->volume * (1 + 0.5 / reservoir->water_rock) >
-               (1 + volume_accuracy) * req_volume)) ||
-         reservoir->volume == 0) {
-    temp_used_points.clear();
-    reservoir->volume = 0;
-    reservoir->area = 0;
-
-    queue<ArrayCoordinate> q;
-    q.push(reservoir->pour_point);
-    while (!q.empty()) {
-      ArrayCoordinate p = q.front();
-      q.pop();
-
-      if (full_cur_model != NULL)
-        full_cur_model->set(p.row + offset.row, p.col + offset.col, 1);
-
-      ArrayCoordinate full_big_ac = {p.row + offset.row, p.col + offset.col, DEM->get_origin()};
-
-      temp_used_points.push_back(full_big_ac);
-			if (seen != NULL && seen->get(full_big_ac.row, full_big_ac.col)){
-				if (non_overlap != NULL){
-					*non_overlap = false;
-				} else {
-					return false;
-				}
-			}
-      if (DEM->get(full_big_ac.row, full_big_ac.col) < -2000)
-        return false;
-
-      reservoir->volume +=
-          (reservoir->dam_height -
-           (DEM->get(full_big_ac.row, full_big_ac.col) -
-            DEM->get(reservoir_big_ac.row, reservoir_big_ac.col))) *
-          find_area(full_big_ac) / 100;
-      reservoir->area += find_area(p);
-      update_reservoir_boundary(reservoir->shape_bound, p);
-
-      for (uint d = 0; d < directions.size(); d++) {
-        ArrayCoordinate neighbor = {p.row + directions[d].row,
-                                    p.col + directions[d].col, p.origin};
-        if (flow_directions->check_within(neighbor.row, neighbor.col) &&
-            flow_directions->flows_to(neighbor, p) &&
-            ((DEM->get(neighbor.row + offset.row, neighbor.col + offset.col) -
-              DEM->get(reservoir_big_ac.row, reservoir_big_ac.col)) <
-             reservoir->dam_height)) {
-          q.push(neighbor);
+  do {
+    double dam_height = reservoir->dam_height;
+    if (dam_height > flood->top_height) {
+      flood = find_flood(reservoir, pour_point, dam_height,
+                         MAX(dam_height, MIN(reservoir->max_dam_height,
+                                             2 * dam_height - first_height)),
+                         big_model, flow_directions, cell_sizes, offset, reservoir_big_ac);
+      seen_cells = find_seen_cells(*flood, seen, offset);
+      first_fail = find_first_fail(*flood, seen_cells);
+    }
+    heights.push_back(dam_height);
+
+    if (first_fail < dam_height) {
+      // Stop at the first cell that can't be used, as a flood to this height would
+      size_t end = 0;
+      while (end < flood->cells.size() &&
+             !(flood->cells[end].path_max < dam_height && flood->cells[end].void_cell))
+        end++;
+      for (uint i : seen_cells)
+        if (i < end && flood->cells[i].path_max < dam_height) {
+          end = i;
+          break;
         }
-      }
+      sum_flood(*flood, dam_height, end, reservoir->volume, reservoir->area);
+      return false;
     }
 
-    if (req_volume >0 && reservoir->volume * (1 + 0.5 / reservoir->water_rock) <
-        (1 - volume_accuracy) * req_volume) {
-      reservoir->dam_height += dam_wall_height_resolution;
+    double volume_ratio = 1 + 0.5 / reservoir->water_rock;
+    double min_volume = (1 - params.volume_accuracy) * req_volume;
+    double max_volume = (1 + params.volume_accuracy) * req_volume;
+    double error;
+    double volume = estimate_volume(dam_height, *flood, error);
+    double ratio_error = error * fabs(volume_ratio) + DBL_EPSILON * fabs(volume * volume_ratio);
+    if (!(fabs(volume * volume_ratio - min_volume) > ratio_error &&
+          fabs(volume * volume_ratio - max_volume) > ratio_error && fabs(volume) > error)) {
+      double area;
+      sum_flood(*flood, dam_height, flood->cells.size(), volume, area);
+    }
+    too_low = req_volume > 0 && volume * volume_ratio < min_volume;
+    too_high = req_volume > 0 && volume * volume_ratio > max_volume;
+    empty = volume == 0;
+
+    if (too_low) {
+      reservoir->dam_height += params.dam_wall_height_resolution;
       if (reservoir->dam_height > reservoir->max_dam_height)
         return false;
       last_dir = 'u';
     }
 
-    if (req_volume >0 && reservoir->volume * (1 + 0.5 / reservoir->water_rock) >
-        (1 + volume_accuracy) * req_volume) {
+    if (too_high) {
       if (last_dir == 'u')
         return false;
-      reservoir->dam_height -= dam_wall_height_resolution;
+      reservoir->dam_height -= params.dam_wall_height_resolution;
       last_dir = 'd';
     }
-  }
+  } while (too_low || too_high || empty);
 
-  if (reservoir->dam_height < minimum_dam_height) {
+  update_shape_bound(*flood, reservoir->shape_bound, heights);
+  sum_flood(*flood, reservoir->dam_height, flood->cells.size(), reservoir->volume,
+            reservoir->area);
+
+  if (reservoir->dam_height < params.minimum_dam_height) {
     return false;
   }
 
-  if (used_points != NULL)
-    for (uint i = 0; i < temp_used_points.size(); i++) {
-      used_points->push_back(temp_used_points[i]);
-    }
+  double top = *max_element(heights.begin(), heights.end());
+  if (reached != NULL)
+    mark_reached(*flood, top, offset, reached);
+
+  if (footprint != NULL)
+    for (uint i : flood->order)
+      if (flood->cells[i].path_max < reservoir->dam_height)
+        footprint->add(flood->cells[i].point.row + offset.row,
+                       flood->cells[i].point.col + offset.col);
 
   if (coordinates == NULL)
     return true;
 
+  ArrayCoordinate model_offset;
+  Model<char> *reservoir_model =
+      reservoir_raster(*flood, top, DEM, offset, model_offset);
+
   vector<ArrayCoordinate> reservoir_polygon;
-  reservoir_polygon = convert_to_polygon(full_cur_model, offset, reservoir->pour_point, 1);
+  reservoir_polygon = convert_to_polygon(reservoir_model, model_offset, reservoir->pour_point, 1);
 
-  // full_cur_model->write("out1.tif", GDT_Byte);
+  // reservoir_model->write("out1.tif", GDT_Byte);
   // DAM WALL
   reservoir->dam_volume = 0;
   reservoir->dam_length = 0;
@@ -389,11 +690,14 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
                                DEM->get(adjacent[1].row + offset.row,
                                         adjacent[1].col + offset.col)) /
                               2.0;
-      if (full_cur_model->get(adjacent[0].row + offset.row, adjacent[0].col + offset.col) != 1) {
-        full_cur_model->set(adjacent[0].row + offset.row, adjacent[0].col + offset.col, 2);
+      if (reservoir_model->get(adjacent[0].row + model_offset.row,
+                               adjacent[0].col + model_offset.col) != 1) {
+        reservoir_model->set(adjacent[0].row + model_offset.row,
+                             adjacent[0].col + model_offset.col, 2);
 
       } else {
-        full_cur_model->set(adjacent[1].row + offset.row, adjacent[1].col + offset.col, 2);
+        reservoir_model->set(adjacent[1].row + model_offset.row,
+                             adjacent[1].col + model_offset.col, 2);
       }
       if (!last) {
         vector<ArrayCoordinate> temp;
@@ -403,7 +707,7 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
       double height =
           reservoir->elevation + reservoir->dam_height - average_height;
       double length = find_distance(point1, point2) * 1000;
-      reservoir->dam_volume += convert_to_dam_volume(height, length);
+      reservoir->dam_volume += convert_to_dam_volume(height, length, params);
       reservoir->dam_length += length;
       dam_polygon[dam_polygon.size() - 1].push_back(point2);
       last = true;
@@ -414,7 +718,7 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
     }
   }
 
-  //full_cur_model->write("out2.tif", GDT_Byte);
+  //reservoir_model->write("out2.tif", GDT_Byte);
   if (polygon_bool[0] && polygon_bool[dam_polygon.size() - 1] &&
       !is_turkeys_nest && dam_polygon.size() > 1) {
     for (uint i = 0; i < dam_polygon[dam_polygon.size() - 1].size(); i++) {
@@ -426,13 +730,14 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
   for (uint i = 0; i < dam_polygon.size(); i++) {
     ArrayCoordinate *adjacent = get_adjacent_cells(dam_polygon[i][0], dam_polygon[i][1]);
     ArrayCoordinate to_check = adjacent[1];
-    if (full_cur_model->get(adjacent[0].row + offset.row, adjacent[0].col + offset.col) == 2)
+    if (reservoir_model->get(adjacent[0].row + model_offset.row,
+                             adjacent[0].col + model_offset.col) == 2)
       to_check = adjacent[0];
     vector<GeographicCoordinate> polygon;
-    polygon = compress_poly(
-        corner_cut_poly(convert_poly(convert_to_polygon(full_cur_model, offset, to_check, 2))));
+    polygon = compress_poly(corner_cut_poly(
+        convert_poly(convert_to_polygon(reservoir_model, model_offset, to_check, 2))));
     string polygon_string =
-        str(polygon, reservoir->elevation + reservoir->dam_height + freeboard);
+        str(polygon, reservoir->elevation + reservoir->dam_height + params.freeboard);
     coordinates->dam.push_back(polygon_string);
   }
 
@@ -447,30 +752,8 @@ bool model_reservoir(Reservoir *reservoir, Reservoir_KML_Coordinates *coordinate
 
   coordinates->is_turkeys_nest = is_turkeys_nest;
 
-  queue<ArrayCoordinate> q;
-  q.push(reservoir->pour_point);
-  while (!q.empty()) {
-    ArrayCoordinate p = q.front();
-    q.pop();
-    full_cur_model->set(p.row + offset.row, p.col + offset.col, 0);
-    for (uint d = 0; d < directions.size(); d++) {
-      ArrayCoordinate neighbor = {p.row + directions[d].row,
-                                  p.col + directions[d].col, p.origin};
-      if (full_cur_model->get(neighbor.row + offset.row,
-                              neighbor.col + offset.col) != 0) {
-        full_cur_model->set(neighbor.row + offset.row,
-                            neighbor.col + offset.col, 0);
-        q.push(neighbor);
-      }
-    }
-  }
-  for (uint i = 0; i < countries.size(); i++) {
-    if (check_within(convert_coordinates(reservoir->pour_point),
-                     countries[i])) {
-      reservoir->country = country_names[i];
-      break;
-    }
-  }
+  if (countries != NULL)
+    countries->find(convert_coordinates(reservoir->pour_point), reservoir->country);
 
   return true;
 }
@@ -3,12 +3,15 @@
 
 #include "phes_base.h"
 #include "kml.h"
+#include "occupancy.hpp"
+
+class CountryIndex;
 
 vector<double> find_polygon_intersections(double lat, vector<GeographicCoordinate> &polygon);
 bool check_within(GeographicCoordinate point, vector<vector<GeographicCoordinate>> polygons);
 vector<vector<vector<GeographicCoordinate>>> read_countries(string filename, vector<string>& country_names);
 ArrayCoordinate* get_adjacent_cells(ArrayCoordinate point1, ArrayCoordinate point2);
-bool is_edge(ArrayCoordinate point1, ArrayCoordinate point2, Model<char>* model, ArrayCoordinate offset, int threshold);
+bool is_edge(GridPoint point1, GridPoint point2, Model<char>* model, ArrayCoordinate offset, int threshold);
 bool is_dam_wall(ArrayCoordinate point1, ArrayCoordinate point2, Model<short>* DEM, ArrayCoordinate offset, double wall_elevation);
 
 vector<ArrayCoordinate> convert_to_polygon(Model<char>* model, ArrayCoordinate offset, ArrayCoordinate pour_point, int threshold);
@@ -17,10 +20,9 @@ vector<GeographicCoordinate> corner_cut_poly(vector<GeographicCoordinate> polygo
 vector<GeographicCoordinate> compress_poly(vector<GeographicCoordinate> polygon);
 string str(vector<GeographicCoordinate> polygon, double elevation);
 bool model_reservoir(Reservoir *reservoir,
-                     Reservoir_KML_Coordinates *coordinates, Model<bool> *seen,
-                     bool *non_overlap, vector<ArrayCoordinate> *used_points,
-                     BigModel big_model, Model<char> *full_cur_model,
-                     vector<vector<vector<GeographicCoordinate>>> &countries,
-                     vector<string> &country_names);
+                     Reservoir_KML_Coordinates *coordinates, Occupancy *seen,
+                     Footprint *reached, Footprint *footprint,
+                     BigModel big_model,
+                     const CountryIndex *countries, const SearchParameters &params);
 
 #endif
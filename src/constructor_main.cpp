@@ -0,0 +1,12 @@
+#include "phes_base.h"
+#include "stages.hpp"
+
+int main(int nargs, char **argv) {
+  search_config = SearchConfig(nargs, argv);
+
+  GDALAllRegister();
+  parse_variables(convert_string("storage_location"));
+  parse_variables(convert_string(file_storage_location + "variables"));
+
+  return run_constructor();
+}
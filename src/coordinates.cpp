@@ -25,6 +25,11 @@ ArrayCoordinate ArrayCoordinate_init(int row, int col, GeographicCoordinate orig
 	return array_coordinate;
 }
 
+ArrayCoordinate ArrayCoordinate_init(GridPoint point, GeographicCoordinate origin)
+{
+	return ArrayCoordinate_init(point.row, point.col, origin);
+}
+
 ArrayCoordinateWithHeight ArrayCoordinateWithHeight_init(int row, int col, double h)
 {
 	ArrayCoordinateWithHeight array_coordinate;
@@ -91,6 +96,11 @@ double find_area(ArrayCoordinate c)
 	return (0.0001*resolution*resolution)*COS(RADIANS(p.lat));
 }
 
+double find_area(GridPoint c, GeographicCoordinate origin)
+{
+	return find_area(ArrayCoordinate_init(c, origin));
+}
+
 
 double find_distance(ArrayCoordinate c1, ArrayCoordinate c2)
 {
@@ -166,3 +176,8 @@ double find_orthogonal_nn_distance(ArrayCoordinate c1, ArrayCoordinate c2)
 	GeographicCoordinate p2 = convert_coordinates(c2);
 	return (COS(RADIANS(0.5*(p1.lat+p2.lat)))*resolution);
 }
+
+double find_orthogonal_nn_distance(GridPoint c1, GridPoint c2, GeographicCoordinate origin)
+{
+	return find_orthogonal_nn_distance(ArrayCoordinate_init(c1, origin), ArrayCoordinate_init(c2, origin));
+}
@@ -7,6 +7,7 @@ using namespace std;
 
 struct GeographicCoordinate;
 struct ArrayCoordinate;
+struct GridPoint;
 template <class T> class Model;
 
 struct GridSquare {
@@ -24,6 +25,7 @@ GeographicCoordinate GeographicCoordinate_init(double latitude,
 ArrayCoordinate ArrayCoordinate_init(int row, int col);
 ArrayCoordinate ArrayCoordinate_init(int row, int col,
                                      GeographicCoordinate origin);
+ArrayCoordinate ArrayCoordinate_init(GridPoint point, GeographicCoordinate origin);
 GridSquare GridSquare_init(int latitude, int longitude);
 ArrayCoordinateWithHeight ArrayCoordinateWithHeight_init(int row, int col,
                                                          double h);
@@ -33,6 +35,7 @@ bool check_within(ArrayCoordinate c, int shape[2]);
 bool check_within(GeographicCoordinate gc, GridSquare gs);
 string str(GridSquare square);
 double find_area(ArrayCoordinate c);
+double find_area(GridPoint c, GeographicCoordinate origin);
 double find_distance(ArrayCoordinate c1, ArrayCoordinate c2);
 double find_distance(ArrayCoordinate c1, ArrayCoordinate c2, double coslat);
 double find_distance_sqd(ArrayCoordinate c1, ArrayCoordinate c2);
@@ -50,5 +53,6 @@ ArrayCoordinate convert_coordinates(GeographicCoordinate c,
                                     GeographicCoordinate origin, double lat_res,
                                     double lon_res);
 double find_orthogonal_nn_distance(ArrayCoordinate c1, ArrayCoordinate c2);
+double find_orthogonal_nn_distance(GridPoint c1, GridPoint c2, GeographicCoordinate origin);
 
 #endif
@@ -0,0 +1,97 @@
+#include "country_index.hpp"
+#include "constructor_helpers.hpp"
+
+static const int edges_per_band = 16;
+
+CountryIndex::CountryIndex(string filename) : squares(180 * 360) {
+  vector<vector<vector<GeographicCoordinate>>> countries = read_countries(filename, names);
+  for (uint i = 0; i < countries.size(); i++)
+    for (vector<GeographicCoordinate> &vertices : countries[i]) {
+      if (vertices.size() < 2)
+        continue;
+      Polygon polygon = {(int)i, vertices, INF, -INF, INF, -INF, 0, {}};
+      for (GeographicCoordinate v : vertices) {
+        polygon.min_lat = MIN(polygon.min_lat, v.lat);
+        polygon.max_lat = MAX(polygon.max_lat, v.lat);
+        polygon.min_lon = MIN(polygon.min_lon, v.lon);
+        polygon.max_lon = MAX(polygon.max_lon, v.lon);
+      }
+      int nbands = MAX(1, (int)vertices.size() / edges_per_band);
+      polygon.band_height = (polygon.max_lat - polygon.min_lat) / nbands;
+      if (polygon.band_height <= 0)
+        nbands = 1;
+      polygon.bands.resize(nbands);
+      for (uint e = 0; e + 1 < vertices.size(); e++) {
+        double low = MIN(vertices[e].lat, vertices[e + 1].lat);
+        double high = MAX(vertices[e].lat, vertices[e + 1].lat);
+        if (low == high)
+          continue;
+        for (int b = band(polygon, low); b <= band(polygon, high); b++)
+          polygon.bands[b].push_back(e);
+      }
+      for (int row = square(polygon.min_lat, 0) / 360; row <= square(polygon.max_lat, 0) / 360;
+           row++)
+        for (int col = square(0, polygon.min_lon - EPS) % 360;
+             col <= square(0, polygon.max_lon + EPS) % 360; col++)
+          squares[360 * row + col].push_back(polygons.size());
+      polygons.push_back(polygon);
+    }
+}
+
+shared_ptr<const CountryIndex> CountryIndex::load(string filename) {
+  static mutex lock;
+  static map<string, shared_ptr<const CountryIndex>> loaded;
+  lock_guard<mutex> guard(lock);
+  shared_ptr<const CountryIndex> &index = loaded[filename];
+  if (!index)
+    index = make_shared<const CountryIndex>(filename);
+  return index;
+}
+
+int CountryIndex::square(double lat, double lon) const {
+  // Clamped before converting, as some polygons in the file have vertices far outside the globe
+  int row = MAX(0.0, MIN(179.0, FLOOR(lat + 90)));
+  int col = MAX(0.0, MIN(359.0, FLOOR(lon + 180)));
+  return 360 * row + col;
+}
+
+int CountryIndex::band(const Polygon &polygon, double lat) const {
+  int nbands = polygon.bands.size();
+  if (nbands == 1)
+    return 0;
+  return MAX(0.0, MIN(nbands - 1.0, FLOOR((lat - polygon.min_lat) / polygon.band_height)));
+}
+
+/*
+ * The test of check_within, over the edges that can cross the point's latitude. An edge only
+ * crosses a latitude above its lower end and up to its upper end, and a crossing lies between the
+ * ends' longitudes, so points outside the bounding box are not in the polygon.
+ */
+bool CountryIndex::contains(const Polygon &polygon, GeographicCoordinate point) const {
+  double lat = point.lat;
+  if (lat <= polygon.min_lat || lat > polygon.max_lat || point.lon < polygon.min_lon - EPS ||
+      point.lon > polygon.max_lon + EPS)
+    return false;
+  const vector<GeographicCoordinate> &v = polygon.vertices;
+  vector<double> intersections;
+  for (int e : polygon.bands[band(polygon, lat)]) {
+    GeographicCoordinate line[2] = {v[e], v[e + 1]};
+    if ((line[0].lat < lat && line[1].lat >= lat) || (line[0].lat >= lat && line[1].lat < lat))
+      intersections.push_back(line[0].lon + (lat - line[0].lat) / (line[1].lat - line[0].lat) *
+                                                (line[1].lon - line[0].lon));
+  }
+  sort(intersections.begin(), intersections.end());
+  for (uint j = 0; j < intersections.size() / 2; j++)
+    if (intersections[2 * j] <= point.lon && point.lon <= intersections[2 * j + 1])
+      return true;
+  return false;
+}
+
+bool CountryIndex::find(GeographicCoordinate point, string &country) const {
+  for (int i : squares[square(point.lat, point.lon)])
+    if (contains(polygons[i], point)) {
+      country = names[polygons[i].country];
+      return true;
+    }
+  return false;
+}
@@ -0,0 +1,39 @@
+#ifndef COUNTRY_INDEX_H
+#define COUNTRY_INDEX_H
+
+#include "phes_base.h"
+
+// The country polygons of input/countries/countries.txt, indexed for finding which country a point
+// is in. The polygons are listed in each one degree square their bounding box touches, and each
+// polygon keeps its edges sorted into latitude bands, so a lookup only crosses the edges of one
+// band of the polygons near the point. Lookups give the same country as check_within over each
+// country in order.
+class CountryIndex {
+public:
+  CountryIndex(string filename);
+
+  // The index, read once per process for each file
+  static shared_ptr<const CountryIndex> load(string filename);
+
+  // Sets country to the first country containing point, returning false if there isn't one
+  bool find(GeographicCoordinate point, string &country) const;
+
+private:
+  struct Polygon {
+    int country;
+    vector<GeographicCoordinate> vertices;
+    double min_lat, max_lat, min_lon, max_lon;
+    double band_height;
+    vector<vector<int>> bands; // The edges, by the index of their first vertex, in each band
+  };
+
+  int square(double lat, double lon) const;
+  int band(const Polygon &polygon, double lat) const;
+  bool contains(const Polygon &polygon, GeographicCoordinate point) const;
+
+  vector<string> names;
+  vector<Polygon> polygons; // In the order of the countries
+  vector<vector<int>> squares; // The polygons that may hold points in each square, in order
+};
+
+#endif
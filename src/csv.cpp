@@ -13,14 +13,17 @@ string ReplaceAll(string str, const string &from, const string &to) {
   return str;
 }
 
+static string quote_csv_column(string col) {
+  col = ReplaceAll(col, string("\""), string("\"\""));
+  col = ReplaceAll(col, string("  "), string(""));
+  col = ReplaceAll(col, string("\n"), string(""));
+  return '"' + col + '"';
+}
+
 void write_to_csv_file(FILE *csv_file, vector<string> cols) {
   for (uint i = 0; i < cols.size(); i++) {
-    if (cols[i].find(',') != std::string::npos) {
-      cols[i] = ReplaceAll(cols[i], string("\""), string("\"\""));
-      cols[i] = ReplaceAll(cols[i], string("  "), string(""));
-      cols[i] = ReplaceAll(cols[i], string("\n"), string(""));
-      cols[i] = '"' + cols[i] + '"';
-    }
+    if (cols[i].find(',') != std::string::npos)
+      cols[i] = quote_csv_column(cols[i]);
     fprintf(csv_file, "%s", cols[i].c_str());
     if (i != cols.size() - 1)
       fprintf(csv_file, ",");
@@ -28,6 +31,53 @@ void write_to_csv_file(FILE *csv_file, vector<string> cols) {
   fprintf(csv_file, "\n");
 }
 
+static const size_t csv_block_size = 1 << 20;
+
+void CSVWriter::start_column() {
+  if (!new_row)
+    buffer.push_back(',');
+  new_row = false;
+}
+
+void CSVWriter::add(const string &col) {
+  start_column();
+  if (col.find(',') != string::npos)
+    buffer += quote_csv_column(col);
+  else
+    buffer += col;
+}
+
+void CSVWriter::add(double value, int decimals) {
+  start_column();
+  char digits[400];
+  to_chars_result result =
+      to_chars(digits, digits + sizeof(digits), value, chars_format::fixed, decimals);
+  if (result.ec == errc())
+    buffer.append(digits, result.ptr);
+  else
+    buffer += dtos(value, decimals);
+}
+
+void CSVWriter::add(long value) {
+  start_column();
+  char digits[24];
+  buffer.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+void CSVWriter::end_row() {
+  buffer.push_back('\n');
+  new_row = true;
+  if (file && buffer.size() >= csv_block_size)
+    flush();
+}
+
+void CSVWriter::flush() {
+  if (!file || buffer.empty())
+    return;
+  fwrite(buffer.data(), 1, buffer.size(), file);
+  buffer.clear();
+}
+
 vector<string> read_from_csv_file(string line) {
   return read_from_csv_file(line, ',');
 }
@@ -160,68 +210,147 @@ void write_rough_reservoir_data_header(FILE *csv_file) {
   write_to_csv_file(csv_file, header);
 }
 
-void write_rough_reservoir_csv(FILE *csv_file, RoughReservoir reservoir) {
-  vector<string> line = {reservoir.identifier,
-                         dtos(reservoir.latitude, 4),
-                         dtos(reservoir.longitude, 4),
-                         to_string(reservoir.elevation),
-                         dtos(reservoir.max_dam_height, 0),
-                         dtos(reservoir.watershed_area, 1)};
+void write_rough_reservoir_csv(CSVWriter &csv, RoughReservoir &reservoir) {
+  csv.add(reservoir.identifier);
+  csv.add(reservoir.latitude, 4);
+  csv.add(reservoir.longitude, 4);
+  csv.add(reservoir.elevation);
+  csv.add(reservoir.max_dam_height, 0);
+  csv.add(reservoir.watershed_area, 1);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir.volumes[i], 2));
+    csv.add(reservoir.volumes[i], 2);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir.areas[i], 2));
+    csv.add(reservoir.areas[i], 2);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir.dam_volumes[i], 2));
+    csv.add(reservoir.dam_volumes[i], 2);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir.water_rocks[i], 1));
-  write_to_csv_file(csv_file, line);
+    csv.add(reservoir.water_rocks[i], 1);
+  csv.end_row();
 }
 
-void write_rough_reservoir_data(FILE *csv_file, RoughReservoir *reservoir) {
-  vector<string> line = {reservoir->identifier,
-                         dtos(reservoir->latitude, 5),
-                         dtos(reservoir->longitude, 5),
-                         to_string(reservoir->elevation),
-                         dtos(reservoir->max_dam_height, 1),
-                         dtos(reservoir->watershed_area, 2)};
+void write_rough_reservoir_data(CSVWriter &csv, RoughReservoir *reservoir) {
+  csv.add(reservoir->identifier);
+  csv.add(reservoir->latitude, 5);
+  csv.add(reservoir->longitude, 5);
+  csv.add(reservoir->elevation);
+  csv.add(reservoir->max_dam_height, 1);
+  csv.add(reservoir->watershed_area, 2);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir->volumes[i], 5));
+    csv.add(reservoir->volumes[i], 5);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir->areas[i], 2));
+    csv.add(reservoir->areas[i], 2);
   for (uint i = 0; i < dam_wall_heights.size(); i++)
-    line.push_back(dtos(reservoir->dam_volumes[i], 5));
+    csv.add(reservoir->dam_volumes[i], 5);
   if (reservoir->river)
-    line.push_back("3");
+    csv.add(3);
   else if (reservoir->pit)
-    line.push_back("2");
+    csv.add(2);
   else if (reservoir->brownfield)
-    line.push_back("1");
+    csv.add(1);
   else
-    line.push_back("0");
-  line.push_back(to_string(reservoir->ocean));
-  line.push_back(to_string(reservoir->turkey));
+    csv.add(0);
+  csv.add(reservoir->ocean);
+  csv.add(reservoir->turkey);
   if(RoughGreenfieldReservoir* gr = dynamic_cast<RoughGreenfieldReservoir*>(reservoir))
     for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
       for (uint idir = 0; idir < directions.size(); idir++) {
-        line.push_back(to_string(gr->shape_bound[ih][idir].row));
-        line.push_back(to_string(gr->shape_bound[ih][idir].col));
+        csv.add(gr->shape_bound[ih][idir].row);
+        csv.add(gr->shape_bound[ih][idir].col);
       }
     }
   if(RoughBfieldReservoir* br = dynamic_cast<RoughBfieldReservoir*>(reservoir)){
-    line.push_back(to_string(br->shape_bound.size()));
-    for(ArrayCoordinate c : br->shape_bound){
-      line.push_back(to_string(c.row));
-      line.push_back(to_string(c.col));
+    csv.add((long)br->shape_bound.size());
+    for(GridPoint c : br->shape_bound){
+      csv.add(c.row);
+      csv.add(c.col);
     }
     if(br->river)
       for(int e : br->elevations)
-        line.push_back(to_string(e));
+        csv.add(e);
   }
-  write_to_csv_file(csv_file, line);
+  csv.end_row();
+}
+
+vector<string> rough_reservoir_data_row(RoughReservoir *reservoir) {
+  CSVWriter row;
+  write_rough_reservoir_data(row, reservoir);
+  return read_from_csv_file(row.text());
+}
+
+unique_ptr<RoughReservoir> parse_rough_reservoir_data_row(vector<string> &line,
+                                                          bool compressed_format) {
+  GeographicCoordinate gc =
+      GeographicCoordinate_init(stod(line[1]), stod(line[2]));
+  GeographicCoordinate origin = get_origin(
+      GridSquare_init(convert_to_int(FLOOR(gc.lat)), convert_to_int(FLOOR(gc.lon))),
+      border);
+  unique_ptr<RoughReservoir> reservoir(new RoughReservoir(convert_coordinates(gc, origin), stoi(line[3])));
+  if(compressed_format){
+    reservoir->brownfield =
+        stoi(line[6 + 3 * dam_wall_heights.size()]) > 0;
+    reservoir->pit =
+        stoi(line[6 + 3 * dam_wall_heights.size()]) == 2;
+    reservoir->river =
+        stoi(line[6 + 3 * dam_wall_heights.size()]) == 3;
+    reservoir->ocean =
+        stoi(line[6 + 3 * dam_wall_heights.size() + 1]) > 0;
+    reservoir->turkey =
+        stoi(line[6 + 3 * dam_wall_heights.size() + 2]) > 0;
+  }else{
+    reservoir->brownfield =
+        stoi(line[6 + 3 * dam_wall_heights.size() +
+                  (dam_wall_heights.size() * directions.size()) * 2]) > 0;
+    reservoir->pit =
+        stoi(line[6 + 3 * dam_wall_heights.size() +
+                  (dam_wall_heights.size() * directions.size()) * 2]) > 1;
+    reservoir->ocean =
+        stoi(line[6 + 3 * dam_wall_heights.size() +
+                  (dam_wall_heights.size() * directions.size()) * 2 + 1]) > 0;
+  }
+  for (uint i = 0; i < dam_wall_heights.size(); i++)
+    if(reservoir->river)
+      reservoir->volumes.push_back(stod(line[6 + i])*60*60*24*365/1e6);
+    else
+      reservoir->volumes.push_back(stod(line[6 + i]));
+  for (uint i = 0; i < dam_wall_heights.size(); i++)
+    reservoir->areas.push_back(stod(line[6 + dam_wall_heights.size() + i]));
+  for (uint i = 0; i < dam_wall_heights.size(); i++)
+    reservoir->dam_volumes.push_back(
+        stod(line[6 + 2 * dam_wall_heights.size() + i]));
+  reservoir->max_dam_height = stod(line[4]);
+  reservoir->watershed_area = stod(line[5]);
+  reservoir->identifier = line[0];
+
+  if(!compressed_format || (!reservoir->ocean && !reservoir->brownfield)){
+    unique_ptr<RoughGreenfieldReservoir> greenfield_reservoir(new RoughGreenfieldReservoir(*reservoir));
+    for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
+      for (uint idir = 0; idir < directions.size(); idir++) {
+        greenfield_reservoir->shape_bound[ih][idir].row =
+            stoi(line[(compressed_format ? 9 : 6) + 3 * dam_wall_heights.size() +
+                      (ih * directions.size() + idir) * 2]);
+        greenfield_reservoir->shape_bound[ih][idir].col =
+            stoi(line[(compressed_format ? 9 : 6) + 3 * dam_wall_heights.size() + 1 +
+                      (ih * directions.size() + idir) * 2]);
+      }
+    }
+    return greenfield_reservoir;
+  } else if(reservoir->ocean || reservoir->brownfield){
+    int point_len = stoi(line[9+3*dam_wall_heights.size()]);
+    unique_ptr<RoughBfieldReservoir> bfield_reservoir(new RoughBfieldReservoir(*reservoir));
+    for(int i = 0; i<point_len; i++){
+      bfield_reservoir->shape_bound.push_back({stoi(line[10+3*dam_wall_heights.size()+i*2]), stoi(line[10+3*dam_wall_heights.size()+i*2+1])});
+    }
+    if(reservoir->river)
+      for(int i = 0; i<point_len; i++){
+        bfield_reservoir->elevations.push_back(stoi(line[10+3*dam_wall_heights.size()+2*point_len+i]));
+      }
+    return bfield_reservoir;
+  }
+  return reservoir;
 }
 
 vector<unique_ptr<RoughReservoir>> read_rough_reservoir_data(char *filename) {
+  count_file_read(filename);
   vector<unique_ptr<RoughReservoir>> reservoirs;
   ifstream inputFile(filename);
   string s;
@@ -235,74 +364,7 @@ vector<unique_ptr<RoughReservoir>> read_rough_reservoir_data(char *filename) {
       continue;
     }
     vector<string> line = read_from_csv_file(s);
-    GeographicCoordinate gc =
-        GeographicCoordinate_init(stod(line[1]), stod(line[2]));
-    GeographicCoordinate origin = get_origin(
-        GridSquare_init(convert_to_int(FLOOR(gc.lat)), convert_to_int(FLOOR(gc.lon))),
-        border);
-    unique_ptr<RoughReservoir> reservoir(new RoughReservoir(convert_coordinates(gc, origin), stoi(line[3])));
-    if(compressed_format){
-      reservoir->brownfield =
-          stoi(line[6 + 3 * dam_wall_heights.size()]) > 0;
-      reservoir->pit =
-          stoi(line[6 + 3 * dam_wall_heights.size()]) == 2;
-      reservoir->river =
-          stoi(line[6 + 3 * dam_wall_heights.size()]) == 3;
-      reservoir->ocean =
-          stoi(line[6 + 3 * dam_wall_heights.size() + 1]) > 0;
-      reservoir->turkey =
-          stoi(line[6 + 3 * dam_wall_heights.size() + 2]) > 0;
-    }else{
-      reservoir->brownfield =
-          stoi(line[6 + 3 * dam_wall_heights.size() +
-                    (dam_wall_heights.size() * directions.size()) * 2]) > 0;
-      reservoir->pit =
-          stoi(line[6 + 3 * dam_wall_heights.size() +
-                    (dam_wall_heights.size() * directions.size()) * 2]) > 1;
-      reservoir->ocean =
-          stoi(line[6 + 3 * dam_wall_heights.size() +
-                    (dam_wall_heights.size() * directions.size()) * 2 + 1]) > 0;
-    }
-    for (uint i = 0; i < dam_wall_heights.size(); i++)
-      if(reservoir->river)
-        reservoir->volumes.push_back(stod(line[6 + i])*60*60*24*365/1e6);
-      else
-        reservoir->volumes.push_back(stod(line[6 + i]));
-    for (uint i = 0; i < dam_wall_heights.size(); i++)
-      reservoir->areas.push_back(stod(line[6 + dam_wall_heights.size() + i]));
-    for (uint i = 0; i < dam_wall_heights.size(); i++)
-      reservoir->dam_volumes.push_back(
-          stod(line[6 + 2 * dam_wall_heights.size() + i]));
-    reservoir->max_dam_height = stod(line[4]);
-    reservoir->watershed_area = stod(line[5]);
-    reservoir->identifier = line[0];
-
-    if(!compressed_format || (!reservoir->ocean && !reservoir->brownfield)){
-      unique_ptr<RoughGreenfieldReservoir> greenfield_reservoir(new RoughGreenfieldReservoir(*reservoir));
-      for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
-        for (uint idir = 0; idir < directions.size(); idir++) {
-          greenfield_reservoir->shape_bound[ih][idir].row =
-              stoi(line[(compressed_format ? 9 : 6) + 3 * dam_wall_heights.size() +
-                        (ih * directions.size() + idir) * 2]);
-          greenfield_reservoir->shape_bound[ih][idir].col =
-              stoi(line[(compressed_format ? 9 : 6) + 3 * dam_wall_heights.size() + 1 +
-                        (ih * directions.size() + idir) * 2]);
-          greenfield_reservoir->shape_bound[ih][idir].origin = origin;
-        }
-      }
-      reservoirs.push_back(std::move(greenfield_reservoir));
-    } else if(reservoir->ocean || reservoir->brownfield){
-      int point_len = stoi(line[9+3*dam_wall_heights.size()]);
-      unique_ptr<RoughBfieldReservoir> bfield_reservoir(new RoughBfieldReservoir(*reservoir));
-      for(int i = 0; i<point_len; i++){
-        bfield_reservoir->shape_bound.push_back(ArrayCoordinate_init(stoi(line[10+3*dam_wall_heights.size()+i*2]), stoi(line[10+3*dam_wall_heights.size()+i*2+1]), origin));
-      }
-      if(reservoir->river)
-        for(int i = 0; i<point_len; i++){
-          bfield_reservoir->elevations.push_back(stoi(line[10+3*dam_wall_heights.size()+2*point_len+i]));
-        }
-      reservoirs.push_back(std::move(bfield_reservoir));
-    }
+    reservoirs.push_back(parse_rough_reservoir_data_row(line, compressed_format));
   }
   if (header) {
     cout << "Cannot read empty CSV " << filename << endl;
@@ -311,6 +373,16 @@ vector<unique_ptr<RoughReservoir>> read_rough_reservoir_data(char *filename) {
   return reservoirs;
 }
 
+vector<unique_ptr<RoughReservoir>>
+round_trip_rough_reservoirs(vector<unique_ptr<RoughReservoir>> &reservoirs) {
+  vector<unique_ptr<RoughReservoir>> to_return;
+  for (unique_ptr<RoughReservoir> &reservoir : reservoirs) {
+    vector<string> line = rough_reservoir_data_row(reservoir.get());
+    to_return.push_back(parse_rough_reservoir_data_row(line, true));
+  }
+  return to_return;
+}
+
 void write_rough_pair_csv_header(FILE *csv_file) {
   vector<string> header = {"Pair Identifier",
                            "Upper Identifier",
@@ -372,69 +444,126 @@ void write_rough_pair_data_header(FILE *csv_file) {
   write_to_csv_file(csv_file, header);
 }
 
-void write_rough_pair_csv(FILE *csv_file, Pair *pair) {
-  vector<string> line = {pair->identifier,
-                         pair->upper.identifier,
-                         dtos(pair->upper.latitude, 4),
-                         dtos(pair->upper.longitude, 4),
-                         to_string(pair->upper.elevation),
-                         dtos(pair->upper.dam_height, 1),
-                         dtos(pair->upper.max_dam_height, 0),
-                         dtos(pair->upper.water_rock, 1),
-                         dtos(pair->upper.area, 1),
-                         pair->lower.identifier,
-                         dtos(pair->lower.latitude, 4),
-                         dtos(pair->lower.longitude, 4),
-                         to_string(pair->lower.elevation),
-                         dtos(pair->lower.dam_height, 1),
-                         dtos(pair->lower.max_dam_height, 0),
-                         dtos(pair->lower.water_rock, 1),
-                         dtos(pair->lower.area, 1),
-                         to_string(pair->head),
-                         dtos(pair->pp_distance, 2),
-                         dtos(pair->distance, 2),
-                         dtos(pair->slope, 2),
-                         dtos(pair->required_volume, 2),
-                         energy_capacity_to_string(pair->energy_capacity),
-                         to_string(pair->storage_time),
-                         dtos(pair->FOM, 1)};
-  write_to_csv_file(csv_file, line);
+void write_rough_pair_csv(CSVWriter &csv, Pair *pair) {
+  csv.add(pair->identifier);
+  csv.add(pair->upper.identifier);
+  csv.add(pair->upper.latitude, 4);
+  csv.add(pair->upper.longitude, 4);
+  csv.add(pair->upper.elevation);
+  csv.add(pair->upper.dam_height, 1);
+  csv.add(pair->upper.max_dam_height, 0);
+  csv.add(pair->upper.water_rock, 1);
+  csv.add(pair->upper.area, 1);
+  csv.add(pair->lower.identifier);
+  csv.add(pair->lower.latitude, 4);
+  csv.add(pair->lower.longitude, 4);
+  csv.add(pair->lower.elevation);
+  csv.add(pair->lower.dam_height, 1);
+  csv.add(pair->lower.max_dam_height, 0);
+  csv.add(pair->lower.water_rock, 1);
+  csv.add(pair->lower.area, 1);
+  csv.add(pair->head);
+  csv.add(pair->pp_distance, 2);
+  csv.add(pair->distance, 2);
+  csv.add(pair->slope, 2);
+  csv.add(pair->required_volume, 2);
+  csv.add(energy_capacity_to_string(pair->energy_capacity));
+  csv.add(pair->storage_time);
+  csv.add(pair->FOM, 1);
+  csv.end_row();
 }
 
-void write_rough_pair_data(FILE *csv_file, Pair *pair) {
-  vector<string> line = {
-      pair->identifier,
-      pair->upper.identifier,
-      dtos(pair->upper.latitude, 6),
-      dtos(pair->upper.longitude, 6),
-      to_string(pair->upper.elevation),
-      dtos(pair->upper.dam_height, 3),
-      dtos(pair->upper.max_dam_height, 1),
-      dtos(pair->upper.water_rock, 5),
-      dtos(pair->upper.area, 1),
-      pair->upper.river ? "3" : (pair->upper.pit ? "2" : to_string(pair->upper.brownfield)),
-      pair->lower.identifier,
-      dtos(pair->lower.latitude, 6),
-      dtos(pair->lower.longitude, 6),
-      to_string(pair->lower.elevation),
-      dtos(pair->lower.dam_height, 3),
-      dtos(pair->lower.max_dam_height, 1),
-      dtos(pair->lower.water_rock, 5),
-      dtos(pair->lower.area, 1),
-      pair->lower.river ? "3" : (pair->lower.pit ? "2" : to_string(pair->lower.brownfield)),
-      to_string(pair->lower.ocean),
-      to_string(pair->head),
-      dtos(pair->pp_distance, 5),
-      dtos(pair->distance, 5),
-      dtos(pair->slope, 6),
-      dtos(pair->required_volume, 5),
-      energy_capacity_to_string(pair->energy_capacity),
-      to_string(pair->storage_time),
-      dtos(pair->FOM, 3)};
-  write_to_csv_file(csv_file, line);
+void write_rough_pair_data(CSVWriter &csv, Pair *pair) {
+  csv.add(pair->identifier);
+  csv.add(pair->upper.identifier);
+  csv.add(pair->upper.latitude, 6);
+  csv.add(pair->upper.longitude, 6);
+  csv.add(pair->upper.elevation);
+  csv.add(pair->upper.dam_height, 3);
+  csv.add(pair->upper.max_dam_height, 1);
+  csv.add(pair->upper.water_rock, 5);
+  csv.add(pair->upper.area, 1);
+  csv.add(pair->upper.river ? 3 : (pair->upper.pit ? 2 : pair->upper.brownfield));
+  csv.add(pair->lower.identifier);
+  csv.add(pair->lower.latitude, 6);
+  csv.add(pair->lower.longitude, 6);
+  csv.add(pair->lower.elevation);
+  csv.add(pair->lower.dam_height, 3);
+  csv.add(pair->lower.max_dam_height, 1);
+  csv.add(pair->lower.water_rock, 5);
+  csv.add(pair->lower.area, 1);
+  csv.add(pair->lower.river ? 3 : (pair->lower.pit ? 2 : pair->lower.brownfield));
+  csv.add(pair->lower.ocean);
+  csv.add(pair->head);
+  csv.add(pair->pp_distance, 5);
+  csv.add(pair->distance, 5);
+  csv.add(pair->slope, 6);
+  csv.add(pair->required_volume, 5);
+  csv.add(energy_capacity_to_string(pair->energy_capacity));
+  csv.add(pair->storage_time);
+  csv.add(pair->FOM, 3);
+  csv.end_row();
+}
+
+vector<string> rough_pair_data_row(Pair *pair) {
+  CSVWriter row;
+  write_rough_pair_data(row, pair);
+  return read_from_csv_file(row.text());
+}
+
+Pair parse_rough_pair_data_row(vector<string> &line) {
+  Pair pair;
+  GeographicCoordinate gc =
+      GeographicCoordinate_init(stod(line[2]), stod(line[3]));
+  GeographicCoordinate origin =
+      get_origin(GridSquare_init(convert_to_int(FLOOR(gc.lat + EPS)),
+                                 convert_to_int(FLOOR(gc.lon + EPS))),
+                 border);
+  pair.upper = Reservoir_init(convert_coordinates(gc, origin), stoi(line[4]));
+  gc = GeographicCoordinate_init(stod(line[11]), stod(line[12]));
+  origin = get_origin(GridSquare_init(convert_to_int(FLOOR(gc.lat + EPS)),
+                                      convert_to_int(FLOOR(gc.lon + EPS))),
+                      border);
+  pair.lower =
+      Reservoir_init(convert_coordinates(gc, origin), stoi(line[13]));
+
+  pair.identifier = line[0];
+
+  pair.upper.identifier = line[1];
+  pair.upper.dam_height = stod(line[5]);
+  pair.upper.max_dam_height = stod(line[6]);
+  pair.upper.water_rock = stod(line[7]);
+  pair.upper.area = stod(line[8]);
+  pair.upper.brownfield = stoi(line[9]) > 0;
+  pair.upper.pit = stoi(line[9]) == 2;
+  pair.upper.river = stoi(line[9]) == 3;
+
+  pair.lower.identifier = line[10];
+  pair.lower.dam_height = stod(line[14]);
+  pair.lower.max_dam_height = stod(line[15]);
+  pair.lower.water_rock = stod(line[16]);
+  pair.lower.area = stod(line[17]);
+  pair.lower.brownfield = stoi(line[18]) > 0;
+  pair.lower.pit = stoi(line[18]) == 2;
+  pair.lower.river = stoi(line[18]) == 3;
+  pair.lower.ocean = stoi(line[19]) > 0;
+
+  pair.head = stoi(line[20]);
+  pair.pp_distance = stod(line[21]);
+  pair.distance = stod(line[22]);
+  pair.slope = stod(line[23]);
+  pair.required_volume = stod(line[24]);
+  pair.upper.volume = stod(line[24]);
+  pair.lower.volume = stod(line[24]);
+  pair.energy_capacity = stod(line[25]);
+  pair.storage_time = stoi(line[26]);
+
+  pair.FOM = stod(line[27]);
+  return pair;
 }
 
 vector<vector<Pair>> read_rough_pair_data(char *filename) {
+  count_file_read(filename);
   vector<vector<Pair>> pairs;
   for (uint i = 0; i < tests.size(); i++) {
     vector<Pair> t;
@@ -450,54 +579,7 @@ vector<vector<Pair>> read_rough_pair_data(char *filename) {
       continue;
     }
     vector<string> line = read_from_csv_file(s);
-
-    Pair pair;
-    GeographicCoordinate gc =
-        GeographicCoordinate_init(stod(line[2]), stod(line[3]));
-    GeographicCoordinate origin =
-        get_origin(GridSquare_init(convert_to_int(FLOOR(gc.lat + EPS)),
-                                   convert_to_int(FLOOR(gc.lon + EPS))),
-                   border);
-    pair.upper = Reservoir_init(convert_coordinates(gc, origin), stoi(line[4]));
-    gc = GeographicCoordinate_init(stod(line[11]), stod(line[12]));
-    origin = get_origin(GridSquare_init(convert_to_int(FLOOR(gc.lat + EPS)),
-                                        convert_to_int(FLOOR(gc.lon + EPS))),
-                        border);
-    pair.lower =
-        Reservoir_init(convert_coordinates(gc, origin), stoi(line[13]));
-
-    pair.identifier = line[0];
-
-    pair.upper.identifier = line[1];
-    pair.upper.dam_height = stod(line[5]);
-    pair.upper.max_dam_height = stod(line[6]);
-    pair.upper.water_rock = stod(line[7]);
-    pair.upper.area = stod(line[8]);
-    pair.upper.brownfield = stoi(line[9]) > 0;
-    pair.upper.pit = stoi(line[9]) == 2;
-    pair.upper.river = stoi(line[9]) == 3;
-
-    pair.lower.identifier = line[10];
-    pair.lower.dam_height = stod(line[14]);
-    pair.lower.max_dam_height = stod(line[15]);
-    pair.lower.water_rock = stod(line[16]);
-    pair.lower.area = stod(line[17]);
-    pair.lower.brownfield = stoi(line[18]) > 0;
-    pair.lower.pit = stoi(line[18]) == 2;
-    pair.lower.river = stoi(line[18]) == 3;
-    pair.lower.ocean = stoi(line[19]) > 0;
-
-    pair.head = stoi(line[20]);
-    pair.pp_distance = stod(line[21]);
-    pair.distance = stod(line[22]);
-    pair.slope = stod(line[23]);
-    pair.required_volume = stod(line[24]);
-    pair.upper.volume = stod(line[24]);
-    pair.lower.volume = stod(line[24]);
-    pair.energy_capacity = stod(line[25]);
-    pair.storage_time = stoi(line[26]);
-
-    pair.FOM = stod(line[27]);
+    Pair pair = parse_rough_pair_data_row(line);
 
     for (uint i = 0; i < tests.size(); i++)
       if (abs(pair.energy_capacity - tests[i].energy_capacity) < EPS &&
@@ -511,6 +593,19 @@ vector<vector<Pair>> read_rough_pair_data(char *filename) {
   return pairs;
 }
 
+vector<vector<Pair>> round_trip_rough_pairs(vector<Pair> &pairs) {
+  vector<vector<Pair>> to_return(tests.size());
+  for (Pair &p : pairs) {
+    vector<string> line = rough_pair_data_row(&p);
+    Pair pair = parse_rough_pair_data_row(line);
+    for (uint i = 0; i < tests.size(); i++)
+      if (abs(pair.energy_capacity - tests[i].energy_capacity) < EPS &&
+          pair.storage_time == tests[i].storage_time)
+        to_return[i].push_back(pair);
+  }
+  return to_return;
+}
+
 void write_pair_csv_header(FILE *csv_file, bool output_FOM) {
   vector<string> header = {"Pair Identifier",
                            "Class",
@@ -6,6 +6,36 @@
 #include <vector>
 
 void write_to_csv_file(FILE *csv_file, vector<string> cols);
+
+// Builds CSV rows into one reusable buffer, written to the file in large blocks. Columns come out
+// exactly as write_to_csv_file writes them, with numbers formatted as dtos and to_string give them.
+// With no file the rows are only kept in text().
+class CSVWriter {
+public:
+  CSVWriter(FILE *file = NULL) : file(file) {}
+  ~CSVWriter() { flush(); }
+
+  void add(const string &col);
+  void add(double value, int decimals);
+  void add(long value);
+  void end_row();
+  // Writes the buffered rows to the file. Call before counting or closing it.
+  void flush();
+
+  const string &text() const { return buffer; }
+  void clear() {
+    buffer.clear();
+    new_row = true;
+  }
+
+private:
+  void start_column();
+
+  FILE *file;
+  string buffer;
+  bool new_row = true;
+};
+
 vector<string> read_from_csv_file(string line);
 vector<string> read_from_csv_file(string line, char delimeter);
 
@@ -15,16 +45,26 @@ vector<string> read_names(char* filename);
 
 void write_rough_reservoir_csv_header(FILE *csv_file);
 void write_rough_reservoir_data_header(FILE *csv_file);
-void write_rough_reservoir_csv(FILE *csv_file, RoughReservoir reservoir);
-void write_rough_reservoir_data(FILE *csv_file, RoughReservoir *reservoir);
+void write_rough_reservoir_csv(CSVWriter &csv, RoughReservoir &reservoir);
+void write_rough_reservoir_data(CSVWriter &csv, RoughReservoir *reservoir);
+vector<string> rough_reservoir_data_row(RoughReservoir *reservoir);
+unique_ptr<RoughReservoir> parse_rough_reservoir_data_row(vector<string> &line, bool compressed_format);
 vector<unique_ptr<RoughReservoir>> read_rough_reservoir_data(char *filename);
 
 void write_rough_pair_csv_header(FILE *csv_file);
 void write_rough_pair_data_header(FILE *csv_file);
-void write_rough_pair_csv(FILE *csv_file, Pair *pair);
-void write_rough_pair_data(FILE *csv_file, Pair *pair);
+void write_rough_pair_csv(CSVWriter &csv, Pair *pair);
+void write_rough_pair_data(CSVWriter &csv, Pair *pair);
+vector<string> rough_pair_data_row(Pair *pair);
+Pair parse_rough_pair_data_row(vector<string> &line);
 vector<vector<Pair> > read_rough_pair_data(char* filename);
 
+// Stages run in one process hand their results on through these rather than the processing_files
+// CSVs. They give the same values (rounded to the CSV precision) and per-test grouping the next
+// stage would read back from disk, so results match running the stages separately.
+vector<unique_ptr<RoughReservoir>> round_trip_rough_reservoirs(vector<unique_ptr<RoughReservoir>> &reservoirs);
+vector<vector<Pair> > round_trip_rough_pairs(vector<Pair> &pairs);
+
 void write_pair_csv_header(FILE *csv_file, bool output_FOM);
 void write_pair_csv(FILE *csv_file, Pair *pair, bool output_FOM);
 void write_summary_csv_header(FILE *csv_file);
@@ -0,0 +1,145 @@
+#include "csv_compare.hpp"
+
+const uint max_examples = 5;
+
+// Columns that identify a row in the pipeline's CSVs
+static const set<string> key_columns = {"Identifier",   "Pair Identifier",  "Grid Identifier",
+                                        "Reservoir type", "Energy (GWh)", "Storage time (h)"};
+
+static bool read_csv_rows(string filename, vector<string> &header, vector<vector<string>> &rows) {
+  ifstream infile(filename);
+  if (!infile.is_open())
+    return false;
+  string line;
+  bool first = true;
+  while (getline(infile, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty())
+      continue;
+    if (first)
+      header = read_from_csv_file(line);
+    else
+      rows.push_back(read_from_csv_file(line));
+    first = false;
+  }
+  return true;
+}
+
+static bool parse_number(const string &s, double &value) {
+  if (s.empty())
+    return false;
+  char *end;
+  value = strtod(s.c_str(), &end);
+  return *end == '\0';
+}
+
+static bool fields_equal(const string &a, const string &b, double tolerance) {
+  if (a == b)
+    return true;
+  double x, y;
+  if (!parse_number(a, x) || !parse_number(b, y))
+    return false;
+  return fabs(x - y) <= tolerance * MAX(1.0, MAX(fabs(x), fabs(y)));
+}
+
+static string row_key(vector<string> &row, vector<uint> &key_indices) {
+  string key;
+  for (uint i : key_indices)
+    key += (i < row.size() ? row[i] : "") + "|";
+  return key;
+}
+
+CsvComparison compare_csv_files(string filename_a, string filename_b, double tolerance) {
+  CsvComparison comparison;
+  comparison.filename = filename_a;
+  vector<string> header_a, header_b;
+  vector<vector<string>> rows_a, rows_b;
+  comparison.missing_a = !read_csv_rows(filename_a, header_a, rows_a);
+  comparison.missing_b = !read_csv_rows(filename_b, header_b, rows_b);
+  if (comparison.missing_a || comparison.missing_b)
+    return comparison;
+  if (header_a != header_b) {
+    comparison.header_differs = true;
+    return comparison;
+  }
+
+  vector<uint> key_indices;
+  for (uint i = 0; i < header_a.size(); i++)
+    if (key_columns.contains(header_a[i]))
+      key_indices.push_back(i);
+  if (key_indices.empty())
+    key_indices.push_back(0);
+
+  // Rows with the same key are matched in the order they appear
+  map<string, deque<uint>> rows_b_by_key;
+  for (uint i = 0; i < rows_b.size(); i++)
+    rows_b_by_key[row_key(rows_b[i], key_indices)].push_back(i);
+
+  vector<bool> matched_b(rows_b.size(), false);
+  int last_matched = -1;
+  for (uint i = 0; i < rows_a.size(); i++) {
+    string key = row_key(rows_a[i], key_indices);
+    auto it = rows_b_by_key.find(key);
+    if (it == rows_b_by_key.end() || it->second.empty()) {
+      comparison.rows_only_in_a++;
+      if (comparison.examples.size() < max_examples)
+        comparison.examples.push_back("Only in A: " + key);
+      continue;
+    }
+    uint j = it->second.front();
+    it->second.pop_front();
+    matched_b[j] = true;
+    if ((int)j < last_matched)
+      comparison.order_differs = true;
+    last_matched = j;
+
+    vector<string> &row_a = rows_a[i];
+    vector<string> &row_b = rows_b[j];
+    string differences;
+    for (uint c = 0; c < MAX(row_a.size(), row_b.size()); c++) {
+      string a = c < row_a.size() ? row_a[c] : "";
+      string b = c < row_b.size() ? row_b[c] : "";
+      if (!fields_equal(a, b, tolerance))
+        differences += " " + (c < header_a.size() ? header_a[c] : to_string(c)) + ": " + a +
+                       " vs " + b + ";";
+    }
+    if (!differences.empty()) {
+      comparison.rows_differing++;
+      if (comparison.examples.size() < max_examples)
+        comparison.examples.push_back("Differs: " + key + differences);
+    }
+  }
+  for (uint j = 0; j < rows_b.size(); j++) {
+    if (matched_b[j])
+      continue;
+    comparison.rows_only_in_b++;
+    if (comparison.examples.size() < max_examples)
+      comparison.examples.push_back("Only in B: " + row_key(rows_b[j], key_indices));
+  }
+  return comparison;
+}
+
+void print_csv_comparison(CsvComparison &comparison, bool strict_order) {
+  string status = comparison.same(strict_order) ? "SAME" : "DIFFERENT";
+  string detail;
+  if (comparison.missing_a || comparison.missing_b) {
+    status = "MISSING";
+    detail = string("Not found in ") + (comparison.missing_a ? "A" : "") +
+             (comparison.missing_a && comparison.missing_b ? " or " : "") +
+             (comparison.missing_b ? "B" : "");
+  } else if (comparison.header_differs) {
+    detail = "The headers differ";
+  } else if (comparison.rows_only_in_a + comparison.rows_only_in_b + comparison.rows_differing > 0) {
+    detail = to_string(comparison.rows_only_in_a) + " rows only in A, " +
+             to_string(comparison.rows_only_in_b) + " only in B, " +
+             to_string(comparison.rows_differing) + " differing";
+  } else if (comparison.order_differs) {
+    detail = "The rows are in a different order";
+  }
+  printf("%-9s %s\n", convert_string(status), convert_string(comparison.filename));
+  if (!detail.empty())
+    printf("          %s\n", convert_string(detail));
+  for (string example : comparison.examples)
+    printf("          %s\n", convert_string(example));
+}
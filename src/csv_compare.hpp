@@ -0,0 +1,32 @@
+#ifndef CSV_COMPARE_H
+#define CSV_COMPARE_H
+
+#include "phes_base.h"
+
+// Compares two CSV outputs of the pipeline by content rather than by text. Rows are matched by
+// their key columns (the identifiers, plus the test for files with several tests), so the order
+// of the rows only matters if strict_order is set. Fields that are numbers in both files are equal
+// if they are within tolerance of each other, either absolutely or relative to the larger value.
+struct CsvComparison {
+  string filename;
+  bool missing_a = false;
+  bool missing_b = false;
+  bool header_differs = false;
+  bool order_differs = false;
+  int rows_only_in_a = 0;
+  int rows_only_in_b = 0;
+  int rows_differing = 0;
+  vector<string> examples;  // A few of the differences, for the report
+
+  bool same(bool strict_order) {
+    return !missing_a && !missing_b && !header_differs && rows_only_in_a == 0 &&
+           rows_only_in_b == 0 && rows_differing == 0 && !(strict_order && order_differs);
+  }
+};
+
+CsvComparison compare_csv_files(string filename_a, string filename_b, double tolerance);
+
+// Prints a line for the comparison, followed by the examples if there are differences
+void print_csv_comparison(CsvComparison &comparison, bool strict_order);
+
+#endif
@@ -1,4 +1,5 @@
 #include "phes_base.h"
+#include "cell_sizes.hpp"
 
 int main(int nargs, char **argv)
 {
@@ -33,11 +34,12 @@ int main(int nargs, char **argv)
 	double volume_at_elevation[1001] = {0};
 	double cumulative_area_at_elevation[1001] = {0};
 
+	CellSizes cell_sizes(DEM->get_origin(), DEM->nrows());
 	for(int row = 0; row<extent->nrows(); row++)
 		for(int col = 0; col<extent->ncols(); col++)
 			if(extent->get(row, col)){
 				int elevation_above_pp = MAX(DEM->get(row,col) - min_elevation, 0);
-				area_at_elevation[elevation_above_pp+1] += find_area(ArrayCoordinate_init(row, col, DEM->get_origin()));
+				area_at_elevation[elevation_above_pp+1] += cell_sizes.area({row, col});
 			}
 
 	for (int ih=1; ih<200;ih++) {
@@ -0,0 +1,143 @@
+#include <fcntl.h>
+
+#include "driver_journal.hpp"
+#include "boost/filesystem.hpp"
+namespace fs = boost::filesystem;
+
+static long long modification_time(struct stat &buffer) {
+  return buffer.st_mtim.tv_sec * 1000000000LL + buffer.st_mtim.tv_nsec;
+}
+
+// Lists the files written by a process for a task that currently exist
+vector<TaskOutput> find_task_outputs(string process, string task) {
+  SearchConfig config;
+  try {
+    config = SearchConfig(task);
+  } catch (int e) {
+    return {};
+  }
+  string name = config.filename();
+  vector<string> filenames;
+  if (process == "screening") {
+    filenames.push_back("output/reservoirs/" + name + "_reservoirs.csv");
+    filenames.push_back("processing_files/reservoirs/" + name + "_reservoirs_data.csv");
+    if (config.search_type.not_existing())
+      filenames.push_back("processing_files/flow_directions/" + str(config.grid_square) +
+                          "_flow_directions.tif");
+  } else if (process == "pairing") {
+    filenames.push_back("output/pairs/" + name + "_rough_pairs.csv");
+    filenames.push_back("processing_files/pairs/" + name + "_rough_pairs_data.csv");
+  } else if (process == "pretty_set") {
+    filenames.push_back("processing_files/pretty_set_pairs/" + name +
+                        "_rough_pretty_set_pairs_data.csv");
+  } else if (process == "constructor") {
+    for (string folder : {"output/final_output_classes/", "output/final_output_FOM/"}) {
+      fs::path p(file_storage_location + folder + name);
+      if (!fs::is_directory(p))
+        continue;
+      vector<string> folder_filenames;
+      for (fs::directory_iterator it(p); it != fs::directory_iterator(); it++)
+        folder_filenames.push_back(folder + name + "/" + it->path().filename().string());
+      sort(folder_filenames.begin(), folder_filenames.end());
+      filenames.insert(filenames.end(), folder_filenames.begin(), folder_filenames.end());
+    }
+  }
+
+  vector<TaskOutput> outputs;
+  for (string filename : filenames) {
+    struct stat buffer;
+    if (stat((file_storage_location + filename).c_str(), &buffer) != 0)
+      continue;
+    outputs.push_back({filename, (long)buffer.st_size, modification_time(buffer)});
+  }
+  return outputs;
+}
+
+string journal_key(string process, string task) {
+  return process + "_task_" + format_for_filename(task);
+}
+
+void write_journal_entry(string event, string process, string task, int driver,
+                         double duration, vector<TaskOutput> outputs) {
+  string output_list;
+  for (uint i = 0; i < outputs.size(); i++) {
+    if (i > 0)
+      output_list += ";";
+    output_list += outputs[i].filename + ":" + to_string(outputs[i].size) + ":" +
+                   to_string(outputs[i].mtime);
+  }
+  CSVWriter line;
+  line.add(time(NULL));
+  line.add(event);
+  line.add(process);
+  line.add(format_for_filename(task));
+  line.add(driver);
+  line.add(duration, 2);
+  line.add(output_list);
+  line.end_row();
+  mkdir(convert_string(file_storage_location + "driver_files"), 0770);
+  // The whole line goes in a single write in append mode, so concurrent drivers do not interleave
+  // lines
+  int journal = open(convert_string(file_storage_location + "driver_files/journal"),
+                     O_WRONLY | O_CREAT | O_APPEND, 0660);
+  if (journal < 0) {
+    search_config.logger.error("Failed to open driver journal");
+    return;
+  }
+  if (write(journal, line.text().data(), line.text().size()) != (ssize_t)line.text().size())
+    search_config.logger.error("Failed to write to driver journal");
+  close(journal);
+}
+
+static vector<JournalEntry> read_journal_entries() {
+  vector<JournalEntry> entries;
+  ifstream file(file_storage_location + "driver_files/journal");
+  string line;
+  while (getline(file, line)) {
+    vector<string> cols = read_from_csv_file(line);
+    if (cols.size() != 7)
+      continue;
+    JournalEntry entry;
+    try {
+      entry = {stol(cols[0]), cols[1], cols[2], cols[3], stoi(cols[4]), stod(cols[5]), {}};
+      if (!cols[6].empty())
+        for (string output : read_from_csv_file(cols[6], ';')) {
+          vector<string> fields = read_from_csv_file(output, ':');
+          entry.outputs.push_back({fields.at(0), stol(fields.at(1)), stoll(fields.at(2))});
+        }
+    } catch (exception &e) {
+      search_config.logger.debug("Skipping malformed journal line: " + line);
+      continue;
+    }
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+map<string, JournalEntry> read_journal() {
+  map<string, JournalEntry> journal;
+  for (JournalEntry &entry : read_journal_entries())
+    journal[journal_key(entry.process, entry.task)] = entry;
+  return journal;
+}
+
+map<string, double> read_task_runtimes() {
+  map<string, double> runtimes;
+  for (JournalEntry &entry : read_journal_entries())
+    if (entry.event == "succeeded")
+      runtimes[journal_key(entry.process, entry.task)] = entry.duration;
+  return runtimes;
+}
+
+bool task_succeeded(map<string, JournalEntry> &journal, string process, string task) {
+  auto it = journal.find(journal_key(process, task));
+  if (it == journal.end() || it->second.event != "succeeded")
+    return false;
+  for (TaskOutput &output : it->second.outputs) {
+    struct stat buffer;
+    if (stat((file_storage_location + output.filename).c_str(), &buffer) != 0 ||
+        buffer.st_size != output.size || modification_time(buffer) != output.mtime)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef DRIVER_JOURNAL_H
+#define DRIVER_JOURNAL_H
+
+#include "phes_base.h"
+
+// Append-only record of the state of each (process, task) in driver_files/journal. Each line is
+// <time>,<event>,<process>,<task>,<driver>,<duration (s)>,<outputs> where event is one of claimed,
+// running, succeeded or failed and outputs lists <filename>:<size>:<mtime> separated by ';'.
+
+struct TaskOutput {
+  string filename;  // Relative to file_storage_location
+  long size;
+  long long mtime;  // Modification time (ns since the epoch)
+};
+
+struct JournalEntry {
+  long time;
+  string event;
+  string process;
+  string task;
+  int driver;
+  double duration;
+  vector<TaskOutput> outputs;
+};
+
+vector<TaskOutput> find_task_outputs(string process, string task);
+void write_journal_entry(string event, string process, string task, int driver,
+                         double duration = 0, vector<TaskOutput> outputs = {});
+string journal_key(string process, string task);
+
+// Latest entry for each (process, task), keyed by journal_key
+map<string, JournalEntry> read_journal();
+
+// Runtime (s) of the latest successful run of each (process, task), keyed by journal_key
+map<string, double> read_task_runtimes();
+
+// True if the latest entry for the task succeeded and its outputs still have the recorded size
+// and modification time
+bool task_succeeded(map<string, JournalEntry> &journal, string process, string task);
+
+#endif
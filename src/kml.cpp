@@ -405,41 +405,69 @@ string get_point_kml(Pair* pair, string coordinates){
 "      </Placemark>\n";
 }
 
-string generate_folder(string name, vector<string> records){
-	string to_return =
-"    <Folder>\n"
-"      <name>"+name+"</name>\n";
-	for(uint i = 0; i<records.size();i++)
-		to_return+=records[i];
-	to_return+="    </Folder>\n";
-	return to_return;
+KML_Writer::KML_Writer(vector<string> filenames, string square, Test test) : filenames(filenames){
+	folder_names[UPPERS] = square+" Upper Reservoirs "+str(test);
+	folder_names[UPPER_DAMS] = square+" Upper Dams "+str(test);
+	folder_names[LOWERS] = square+" Lower Reservoirs "+str(test);
+	folder_names[LOWER_DAMS] = square+" Lower Dams "+str(test);
+	folder_names[LINES] = square+" Lines "+str(test);
+	folder_names[POINTS] = square+" Points "+str(test);
+	for(int i = 0; i<FOLDERS; i++){
+		folders[i] = tmpfile();
+		if(folders[i] == NULL){
+			search_config.logger.error("Could not open a temporary file for the KML of " + square);
+			throw(1);
+		}
+	}
 }
 
-string output_kml(KML_Holder* kml_holder, string square, Test test){
-	string to_return;
-	to_return+=kml_start;
-	to_return+=generate_folder(square+" Upper Reservoirs "+str(test), kml_holder->uppers);
-	to_return+=generate_folder(square+" Upper Dams "+str(test), kml_holder->upper_dams);
-	to_return+=generate_folder(square+" Lower Reservoirs "+str(test), kml_holder->lowers);
-	to_return+=generate_folder(square+" Lower Dams "+str(test), kml_holder->lower_dams);
-	to_return+=generate_folder(square+" Lines "+str(test), kml_holder->lines);
-	to_return+=generate_folder(square+" Points "+str(test), kml_holder->points);
-	to_return+=kml_end;
-	return to_return;
+KML_Writer::~KML_Writer(){
+	for(int i = 0; i<FOLDERS; i++)
+		fclose(folders[i]);
+}
+
+void KML_Writer::write(Folder folder, const string &record){
+	fwrite(record.data(), 1, record.size(), folders[folder]);
 }
 
-void update_kml_holder(KML_Holder* kml_holder, Pair* pair, Pair_KML* pair_kml, bool keep_upper, bool keep_lower){
-	kml_holder->points.push_back(get_point_kml(pair, pair_kml->point));
-	kml_holder->lines.push_back(get_line_kml(pair, pair_kml->line));
+void KML_Writer::add(Pair* pair, Pair_KML* pair_kml, bool keep_upper, bool keep_lower){
+	write(POINTS, get_point_kml(pair, pair_kml->point));
+	write(LINES, get_line_kml(pair, pair_kml->line));
 	if (keep_upper) {
-		kml_holder->uppers.push_back(get_reservoir_kml(&pair->upper, upper_colour, pair_kml->upper, pair));
+		write(UPPERS, get_reservoir_kml(&pair->upper, upper_colour, pair_kml->upper, pair));
 		if(!pair->upper.brownfield)
-			kml_holder->upper_dams.push_back(get_dam_kml(&pair->upper, pair_kml->upper));
+			write(UPPER_DAMS, get_dam_kml(&pair->upper, pair_kml->upper));
 	}
 	if (keep_lower) {
 		if(!pair->lower.ocean)
-			kml_holder->lowers.push_back(get_reservoir_kml(&pair->lower, lower_colour, pair_kml->lower, pair));
+			write(LOWERS, get_reservoir_kml(&pair->lower, lower_colour, pair_kml->lower, pair));
 		if(!pair->lower.brownfield && !pair->lower.ocean)
-			kml_holder->lower_dams.push_back(get_dam_kml(&pair->lower, pair_kml->lower));
+			write(LOWER_DAMS, get_dam_kml(&pair->lower, pair_kml->lower));
+	}
+}
+
+void KML_Writer::close(){
+	vector<char> buffer(1 << 16);
+	for(string filename : filenames){
+		FILE *kml_file = fopen(convert_string(filename), "w");
+		if(kml_file == NULL){
+			search_config.logger.error("Could not open " + filename);
+			throw(1);
+		}
+		fputs(kml_start.c_str(), kml_file);
+		for(int i = 0; i<FOLDERS; i++){
+			string header =
+"    <Folder>\n"
+"      <name>"+folder_names[i]+"</name>\n";
+			fputs(header.c_str(), kml_file);
+			rewind(folders[i]);
+			size_t read;
+			while((read = fread(buffer.data(), 1, buffer.size(), folders[i])) > 0)
+				fwrite(buffer.data(), 1, read, kml_file);
+			fputs("    </Folder>\n", kml_file);
+		}
+		fputs(kml_end.c_str(), kml_file);
+		count_file_written(kml_file);
+		fclose(kml_file);
 	}
 }
@@ -3,15 +3,6 @@
 
 #include "phes_base.h"
 
-struct KML_Holder{
-	vector<string> uppers;
-	vector<string> lowers;
-	vector<string> upper_dams;
-	vector<string> lower_dams;
-	vector<string> lines;
-	vector<string> points;
-};
-
 struct Reservoir_KML_Coordinates{
 	string reservoir;
 	vector<string> dam;
@@ -25,8 +16,23 @@ struct Pair_KML{
 	string line;
 };
 
-string output_kml(KML_Holder* kml_holder, string square, Test test);
-void update_kml_holder(KML_Holder* kml_holder, Pair* pair, Pair_KML* pair_kml, bool keep_upper, bool keep_lower);
+// Writes the KML of a test's pairs to each of the files as the pairs are added. The folders of a
+// KML document come one after another, so each folder's placemarks are written to a temporary file
+// until close, which copies the folders into each of the files in order.
+class KML_Writer{
+public:
+	KML_Writer(vector<string> filenames, string square, Test test);
+	~KML_Writer();
+	void add(Pair* pair, Pair_KML* pair_kml, bool keep_upper, bool keep_lower);
+	void close();
+private:
+	enum Folder {UPPERS, UPPER_DAMS, LOWERS, LOWER_DAMS, LINES, POINTS, FOLDERS};
+	void write(Folder folder, const string &record);
+	vector<string> filenames;
+	string folder_names[FOLDERS];
+	FILE* folders[FOLDERS];
+};
+
 string get_reservoir_geometry(Reservoir_KML_Coordinates coordinates);
 string get_dam_geometry(Reservoir_KML_Coordinates coordinates);
 string get_dam_kml(Reservoir* reservoir, Reservoir_KML_Coordinates coordinates);
@@ -0,0 +1,120 @@
+#include "logging.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+bool LogBuffer::push(LogRecord &record) {
+  unsigned t = tail.load(std::memory_order_relaxed);
+  if (t - head.load(std::memory_order_acquire) >= capacity)
+    return false;
+  records[t % capacity] = std::move(record);
+  tail.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+bool LogBuffer::pop(LogRecord &record) {
+  unsigned h = head.load(std::memory_order_relaxed);
+  if (h == tail.load(std::memory_order_acquire))
+    return false;
+  record = std::move(records[h % capacity]);
+  head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool LogBuffer::empty() const {
+  return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+// Owns every thread's buffer and writes them out from a background thread. The buffers are kept
+// after their threads exit until they have been written.
+class LogSink {
+  public:
+    LogSink() : stopping(false), flush_thread(&LogSink::run, this) {}
+
+    ~LogSink() {
+      {
+        std::lock_guard<std::mutex> lock(wake_lock);
+        stopping = true;
+      }
+      wake.notify_one();
+      flush_thread.join();
+      flush();
+    }
+
+    std::shared_ptr<LogBuffer> add_buffer() {
+      std::lock_guard<std::mutex> lock(buffers_lock);
+      buffers.push_back(std::make_shared<LogBuffer>());
+      return buffers.back();
+    }
+
+    void notify() { wake.notify_one(); }
+
+    void flush() {
+      std::lock_guard<std::mutex> lock(buffers_lock);
+      std::string out;
+      LogRecord record;
+      for (size_t i = 0; i < buffers.size(); i++) {
+        while (buffers[i]->pop(record)) {
+          if (!record.tag.empty())
+            out += "[" + record.tag + "] ";
+          out += record.message;
+          out += '\n';
+        }
+      }
+      if (!out.empty()) {
+        std::cout << out;
+        std::cout.flush();
+      }
+      for (size_t i = 0; i < buffers.size();) {
+        if (buffers[i].use_count() == 1 && buffers[i]->empty()) {
+          buffers[i] = buffers.back();
+          buffers.pop_back();
+        } else {
+          i++;
+        }
+      }
+    }
+
+  private:
+    void run() {
+      std::unique_lock<std::mutex> lock(wake_lock);
+      while (!stopping) {
+        wake.wait_for(lock, std::chrono::milliseconds(20));
+        lock.unlock();
+        flush();
+        lock.lock();
+      }
+    }
+
+    std::mutex buffers_lock;
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread flush_thread;
+};
+
+static LogSink &log_sink() {
+  static LogSink sink;
+  return sink;
+}
+
+void log_message(const std::string &tag, std::string message, bool immediate) {
+  thread_local std::shared_ptr<LogBuffer> buffer = log_sink().add_buffer();
+  LogRecord record = {tag, std::move(message)};
+  while (!buffer->push(record)) {
+    log_sink().notify();
+    std::this_thread::yield();
+  }
+  if (immediate)
+    log_sink().flush();
+}
+
+void flush_log() {
+  log_sink().flush();
+}
@@ -0,0 +1,53 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <atomic>
+#include <string>
+#include <type_traits>
+
+struct LogRecord {
+  std::string tag;     // Grid square or reservoir and stage, may be empty
+  std::string message;
+};
+
+// The messages logged by one thread that have not yet been written. Only the owning thread pushes
+// and only the flush thread (or flush_log) pops, so neither side takes a lock.
+class LogBuffer {
+  public:
+    static const unsigned capacity = 1024;
+
+    // Returns false if the buffer is full
+    bool push(LogRecord &record);
+    bool pop(LogRecord &record);
+    bool empty() const;
+
+  private:
+    LogRecord records[capacity];
+    std::atomic<unsigned> head{0}; // Next record to pop
+    std::atomic<unsigned> tail{0}; // Next slot to push into
+};
+
+// Queues a message on the calling thread's buffer for the flush thread to write to stdout. If
+// immediate is set, the message and everything queued before it are written before returning.
+void log_message(const std::string &tag, std::string message, bool immediate);
+
+// Writes out the messages queued by every thread
+void flush_log();
+
+template <typename T> void append_log_argument(std::string &s, const T &value) {
+  if constexpr (std::is_same_v<T, char>)
+    s += value;
+  else if constexpr (std::is_arithmetic_v<T>)
+    s += std::to_string(value);
+  else
+    s += value;
+}
+
+// Concatenates the arguments, formatting numbers with std::to_string
+template <typename... Args> std::string format_log_message(const Args &...args) {
+  std::string s;
+  (append_log_argument(s, args), ...);
+  return s;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "metrics.hpp"
+#include "phes_base.h"
+
+thread_local Metrics metrics;
+
+static const char *counter_names[NUM_COUNTERS] = {
+    "cells_flooded",     "flood_cache_hits",  "pour_points",         "reservoirs_modelled",
+    "pairs_tested",      "pruned_volume",     "pruned_pit",          "pruned_dam_height",
+    "pruned_water_rock", "pruned_slope",      "pruned_FOM",          "bytes_read",
+    "bytes_written"};
+
+void Metrics::reset() {
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    counters[i] = 0;
+  timers.clear();
+}
+
+void Metrics::add_time(const std::string &name, double seconds) {
+  TimerTotal &total = timers[name];
+  total.seconds += seconds;
+  total.calls++;
+}
+
+void Metrics::add(const Metrics &other) {
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    counters[i] += other.counters[i];
+  for (auto &[name, total] : other.timers) {
+    timers[name].seconds += total.seconds;
+    timers[name].calls += total.calls;
+  }
+}
+
+ScopedTimer::ScopedTimer(std::string name) : name(name), start_usec(walltime_usec()) {}
+
+ScopedTimer::~ScopedTimer() {
+  metrics.add_time(name, 1.0e-6 * (walltime_usec() - start_usec));
+}
+
+static long file_size(const std::string &filename) {
+  struct stat buffer;
+  if (stat(filename.c_str(), &buffer) != 0)
+    return 0;
+  return buffer.st_size;
+}
+
+void count_file_read(const std::string &filename) {
+  metrics.count(BYTES_READ, file_size(filename));
+}
+
+void count_file_written(const std::string &filename) {
+  metrics.count(BYTES_WRITTEN, file_size(filename));
+}
+
+void count_file_written(FILE *file) {
+  long position = ftell(file);
+  if (position > 0)
+    metrics.count(BYTES_WRITTEN, position);
+}
+
+static string metrics_section(const string &stage) {
+  string section = "  \"" + stage + "\": {\"timers\": {";
+  char buffer[64];
+  bool first = true;
+  for (auto &[name, total] : metrics.timers) {
+    snprintf(buffer, sizeof(buffer), "{\"seconds\": %.6f, \"calls\": %ld}", total.seconds,
+             total.calls);
+    section += (first ? "\"" : ", \"") + name + "\": " + buffer;
+    first = false;
+  }
+  section += "}, \"counters\": {";
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    section += (i == 0 ? "\"" : ", \"") + string(counter_names[i]) + "\": " +
+               to_string(metrics.counters[i]);
+  return section + "}}";
+}
+
+void write_metrics(const std::string &stage) {
+  string name = search_config.filename();
+  string folder = file_storage_location + "output/metrics/";
+  string filename = folder + name + "_metrics.json";
+  mkdir(convert_string(file_storage_location + "output"), 0777);
+  mkdir(convert_string(folder), 0777);
+
+  // Each stage section is on its own line, so the other stages' sections can be kept as they are
+  vector<string> sections;
+  ifstream infile(filename);
+  string line;
+  string prefix = "  \"" + stage + "\": ";
+  while (getline(infile, line)) {
+    if (line.rfind("  \"", 0) != 0 || line.rfind("  \"name\": ", 0) == 0 ||
+        line.rfind(prefix, 0) == 0)
+      continue;
+    if (line.back() == ',')
+      line.pop_back();
+    sections.push_back(line);
+  }
+  infile.close();
+  sections.push_back(metrics_section(stage));
+
+  // Written to a temporary file first so a partly written file is never read
+  string temp_filename = filename + ".tmp";
+  FILE *file = fopen(convert_string(temp_filename), "w");
+  if (!file) {
+    search_config.logger.error("Could not write ", filename);
+    return;
+  }
+  fprintf(file, "{\n  \"name\": \"%s\",\n", name.c_str());
+  for (uint i = 0; i < sections.size(); i++)
+    fprintf(file, "%s%s\n", sections[i].c_str(), i + 1 < sections.size() ? "," : "");
+  fprintf(file, "}\n");
+  fclose(file);
+  rename(convert_string(temp_filename), convert_string(filename));
+}
@@ -0,0 +1,68 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+enum Counter {
+  CELLS_FLOODED,
+  FLOOD_CACHE_HITS,   // Reservoirs modelled from an earlier flood
+  POUR_POINTS,
+  RESERVOIRS_MODELLED,
+  PAIRS_TESTED,
+  PRUNED_VOLUME,      // Not enough volume in either reservoir
+  PRUNED_PIT,         // No pit elevation gives the required volume
+  PRUNED_DAM_HEIGHT,  // Dam wall higher than the reservoir allows
+  PRUNED_WATER_ROCK,
+  PRUNED_SLOPE,
+  PRUNED_FOM,
+  BYTES_READ,
+  BYTES_WRITTEN,
+  NUM_COUNTERS
+};
+
+struct TimerTotal {
+  double seconds = 0;
+  long calls = 0;
+};
+
+// Timers and counters for the stage running on this thread. Reset at the start of each stage and
+// written to output/metrics/<name>_metrics.json at the end.
+struct Metrics {
+  long counters[NUM_COUNTERS];
+  std::map<std::string, TimerTotal> timers;
+
+  Metrics() { reset(); }
+  void reset();
+  void count(Counter counter, long n = 1) { counters[counter] += n; }
+  void add_time(const std::string &name, double seconds);
+  // Adds the counters and timers of another thread's metrics, such as a worker within a stage
+  void add(const Metrics &other);
+};
+
+extern thread_local Metrics metrics;
+
+// Adds the time until the end of the enclosing scope to the named timer
+class ScopedTimer {
+  public:
+    ScopedTimer(std::string name);
+    ~ScopedTimer();
+
+  private:
+    std::string name;
+    unsigned long start_usec;
+};
+
+// Adds the size of a file that is read in full to BYTES_READ
+void count_file_read(const std::string &filename);
+// Adds the size of a file that has been written to BYTES_WRITTEN
+void count_file_written(const std::string &filename);
+// Adds the bytes written so far to an open file to BYTES_WRITTEN. Call before closing it.
+void count_file_written(FILE *file);
+
+// Replaces the section for stage in output/metrics/<name>_metrics.json, where name is the
+// filename of the thread's search_config, keeping the sections written by the other stages
+void write_metrics(const std::string &stage);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include "metrics.hpp"
 #include "search_config.hpp"
 #include <gdal/gdal.h>
 #include <gdal/gdal_priv.h>
@@ -14,12 +15,12 @@
 
 struct Geodata {
   double geotransform[6];
-  char *geoprojection;
+  string geoprojection;
 
   string projection_str(){
     return to_string(geotransform[0]) + " " + to_string(geotransform[1]) + " " +
         to_string(geotransform[3]) + " " + to_string(geotransform[5]) + " " +
-        string(geoprojection);
+        geoprojection;
 
   }
 };
@@ -33,6 +34,12 @@ struct ArrayCoordinate {
   GeographicCoordinate origin;
 };
 
+// A cell whose origin is held by its owner, such as the Model or the pour point of a reservoir.
+// Used instead of ArrayCoordinate where many cells are queued or stored.
+struct GridPoint {
+  int row, col;
+};
+
 #include "phes_base.h"
 
 template <class T> class Model {
@@ -104,6 +111,7 @@ public:
   }
 
   bool flows_to(ArrayCoordinate c1, ArrayCoordinate c2);
+  bool flows_to(GridPoint c1, GridPoint c2);
 private:
   int rows;
   int cols;
@@ -124,13 +132,16 @@ template <typename T> Model<T>::Model(std::string filename, GDALDataType data_ty
     throw(1);
   }
   if (Dataset->GetProjectionRef() != NULL) {
-    geodata.geoprojection = const_cast<char *>(Dataset->GetProjectionRef());
+    // Copied so the dataset can be closed once read, rather than holding its file open
+    geodata.geoprojection = Dataset->GetProjectionRef();
   } else {
     search_config.logger.error("Cannot get projection from: " + filename);
+    GDALClose((GDALDatasetH)Dataset);
     throw(1);
   }
   if (Dataset->GetGeoTransform(geodata.geotransform) != CE_None) {
     search_config.logger.error("Cannot get transform from: " + filename);
+    GDALClose((GDALDatasetH)Dataset);
     throw(1);
   }
 
@@ -148,8 +159,10 @@ template <typename T> Model<T>::Model(std::string filename, GDALDataType data_ty
   for (int row = 0; row < rows; row++) {
     CPLErr err =
         Band->RasterIO(GF_Read, 0, row, temp_cols, 1, temp_arr, temp_cols, 1, data_type, 0, 0);
-    if (err != CPLE_None)
-      exit(1);
+    if (err != CPLE_None) {
+      GDALClose((GDALDatasetH)Dataset);
+      throw(1);
+    }
     if (temp_cols == 1801) {
       for (int col = 0; col < temp_cols - 1; col++) {
         set(row, col * 2, (T)temp_arr[col]);
@@ -161,6 +174,8 @@ template <typename T> Model<T>::Model(std::string filename, GDALDataType data_ty
         set(row, col, (T)temp_arr[col]);
     }
   }
+  GDALClose((GDALDatasetH)Dataset);
+  count_file_read(filename);
 }
 
 
@@ -170,10 +185,10 @@ template <typename T> void Model<T>::write(string filename, GDALDataType data_ty
   const char *pszFormat = "GTiff";
   GDALDriver *Driver = GetGDALDriverManager()->GetDriverByName(pszFormat);
   if (Driver == NULL)
-    exit(1);
+    throw(1);
   GDALDataset *OutDS = Driver->Create(tif_filename, cols, rows, 1, data_type, NULL);
   OutDS->SetGeoTransform(geodata.geotransform);
-  OutDS->SetProjection(geodata.geoprojection);
+  OutDS->SetProjection(geodata.geoprojection.c_str());
   GDALRasterBand *Band = OutDS->GetRasterBand(1);
   T temp_arr[cols];
   for (int row = 0; row < rows; row++) {
@@ -182,9 +197,10 @@ template <typename T> void Model<T>::write(string filename, GDALDataType data_ty
     }
     CPLErr err = Band->RasterIO(GF_Write, 0, row, cols, 1, temp_arr, cols, 1, data_type, 0, 0);
     if (err != CPLE_None)
-      exit(1);
+      throw(1);
   }
   GDALClose((GDALDatasetH)OutDS);
+  count_file_written(filename);
 }
 
 
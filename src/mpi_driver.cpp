@@ -0,0 +1,131 @@
+#include <mpi.h>
+
+#include "phes_base.h"
+#include "scheduler.hpp"
+#include "driver_journal.hpp"
+
+// Rank 0 hands out tasks to the other ranks as the tasks they depend on finish, so no lockfiles
+// are needed on the shared filesystem. Each worker rank runs the processes in-process and reports
+// back when a task is done.
+
+const int TAG_REQUEST = 1;  // Worker to rank 0: {finished task or -1, success}
+const int TAG_ASSIGN = 2;   // Rank 0 to worker: task to run, or -1 to stop
+
+void make_log_directories(vector<string> &processlist) {
+  mkdir(convert_string(file_storage_location + "debug1"), 0770);
+  mkdir(convert_string(file_storage_location + "debug1/driver_logfiles"), 0770);
+  for (string process : processlist)
+    mkdir(convert_string(file_storage_location + "debug1/" + process + "_logfiles"), 0770);
+}
+
+void run_coordinator(vector<DriverTask> &graph, int nranks) {
+  unique_ptr<TaskCostModel> cost_model;
+  if (longest_first)
+    cost_model.reset(new TaskCostModel());
+  vector<int> remaining_dependencies(graph.size(), 0);
+  vector<int> ready;
+  uint finished_count = 0;
+  for (uint i = 0; i < graph.size(); i++) {
+    if (graph[i].complete) {
+      finished_count++;
+      continue;
+    }
+    for (int dependency : graph[i].dependencies)
+      if (!graph[dependency].complete)
+        remaining_dependencies[i]++;
+    if (remaining_dependencies[i] == 0)
+      ready.push_back(i);
+  }
+  if (finished_count > 0)
+    printf("Skipping %u tasks completed by an earlier run\n", finished_count);
+
+  deque<int> idle_workers;
+  int stopped_workers = 0;
+  while (stopped_workers < nranks - 1) {
+    int message[2];
+    MPI_Status status;
+    MPI_Recv(message, 2, MPI_INT, MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+    int task = message[0];
+    if (task >= 0) {
+      finished_count++;
+      if (!message[1])
+        write_to_logfile(0, "driver", "Rank " + to_string(status.MPI_SOURCE) + " failed " +
+                                          graph[task].process + " " + graph[task].task + "\n");
+      for (int dependent : graph[task].dependents)
+        if (--remaining_dependencies[dependent] == 0)
+          ready.push_back(dependent);
+    }
+    idle_workers.push_back(status.MPI_SOURCE);
+
+    if (cost_model)
+      cost_model->sort_longest_first(graph, ready);
+    while (!idle_workers.empty() && !ready.empty()) {
+      int next_task = ready.front();
+      ready.erase(ready.begin());
+      MPI_Send(&next_task, 1, MPI_INT, idle_workers.front(), TAG_ASSIGN, MPI_COMM_WORLD);
+      idle_workers.pop_front();
+    }
+    if (finished_count == graph.size()) {
+      int stop = -1;
+      while (!idle_workers.empty()) {
+        MPI_Send(&stop, 1, MPI_INT, idle_workers.front(), TAG_ASSIGN, MPI_COMM_WORLD);
+        idle_workers.pop_front();
+        stopped_workers++;
+      }
+    }
+  }
+}
+
+void run_worker(vector<DriverTask> &graph, int rank) {
+  int message[2] = {-1, 1};
+  while (true) {
+    MPI_Send(message, 2, MPI_INT, 0, TAG_REQUEST, MPI_COMM_WORLD);
+    int task;
+    MPI_Recv(&task, 1, MPI_INT, 0, TAG_ASSIGN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (task < 0)
+      break;
+    message[0] = task;
+    message[1] = run_journaled_task(graph[task], rank);
+  }
+  write_to_logfile(rank, "driver", "Done\n");
+}
+
+int main(int nargs, char **argv) {
+  MPI_Init(&nargs, &argv);
+  int rank, nranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+  GDALAllRegister();
+  parse_variables(convert_string("storage_location"));
+  parse_variables(convert_string(file_storage_location + "variables"));
+
+  vector<string> tasklist = read_tasklist(convert_string(file_storage_location + tasks_file));
+  vector<string> processlist =
+      read_processlist(convert_string(file_storage_location + processes_file));
+  // Every rank builds the same graph, so only task indices are sent
+  vector<DriverTask> graph = build_task_graph(tasklist, processlist);
+
+  if (rank == 0) {
+    make_log_directories(processlist);
+    mark_complete_tasks(graph);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  if (nranks == 1) {
+    unique_ptr<TaskCostModel> cost_model;
+    if (longest_first)
+      cost_model.reset(new TaskCostModel());
+    WorkStealingScheduler scheduler(graph, 1, cost_model.get());
+    scheduler.run();
+  } else if (rank == 0) {
+    run_coordinator(graph, nranks);
+  } else {
+    run_worker(graph, rank);
+  }
+
+  if (rank == 0)
+    printf("Done\n");
+  MPI_Finalize();
+  return 0;
+}
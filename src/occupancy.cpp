@@ -0,0 +1,49 @@
+#include "occupancy.hpp"
+
+bool Occupancy::get(int row, int col) {
+  bool found = false;
+  for_each_overlap({row, col, col + 1}, [&](int, int) { found = true; });
+  return found;
+}
+
+bool Occupancy::overlaps(const Footprint &footprint) {
+  bool found = false;
+  for (Run run : footprint.runs) {
+    for_each_overlap(run, [&](int, int) { found = true; });
+    if (found)
+      return true;
+  }
+  return false;
+}
+
+void Occupancy::add(Run run) {
+  if (run.row < 0 || run.row >= rows || run.start >= run.end)
+    return;
+  vector<pair<int, int>> &row = occupied[run.row];
+  if (row.empty())
+    dirty_rows.push_back(run.row);
+  // Merge with the runs that overlap or touch it
+  auto first = lower_bound(row.begin(), row.end(), pair<int, int>(run.start, INT_MIN));
+  if (first != row.begin() && prev(first)->second >= run.start)
+    first--;
+  auto last = first;
+  int start = run.start;
+  int end = run.end;
+  for (; last != row.end() && last->first <= end; last++) {
+    start = MIN(start, last->first);
+    end = MAX(end, last->second);
+  }
+  first = row.erase(first, last);
+  row.insert(first, {start, end});
+}
+
+void Occupancy::add(const Footprint &footprint) {
+  for (Run run : footprint.runs)
+    add(run);
+}
+
+void Occupancy::clear() {
+  for (int row : dirty_rows)
+    occupied[row].clear();
+  dirty_rows.clear();
+}
@@ -0,0 +1,74 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "phes_base.h"
+
+// The cells from start up to but not including end along a row
+struct Run {
+  int row, start, end;
+};
+
+// A set of cells, such as the cells used by a pair, stored as runs along the rows. Cells added in
+// order along a row join the last run, so a reservoir added row by row takes a run for each
+// stretch of a row it covers rather than one entry per cell.
+class Footprint {
+public:
+  void add(int row, int col) {
+    if (!runs.empty() && runs.back().row == row && runs.back().end == col)
+      runs.back().end++;
+    else
+      runs.push_back({row, col, col + 1});
+  }
+  void add(Run run) { runs.push_back(run); }
+  void clear() { runs.clear(); }
+  bool empty() const { return runs.empty(); }
+
+  vector<Run> runs;
+};
+
+// The cells of the big model used by the pairs selected so far, in place of a raster. Each row
+// holds its occupied cells as sorted, disjoint runs, so adding a footprint and finding where a
+// reservoir overlaps the occupied cells cost in proportion to the runs rather than the cells.
+// Rows with no runs take no storage beyond an empty vector, and clear only visits the rows that
+// have been added to, so one Occupancy can be reused for each test.
+class Occupancy {
+public:
+  Occupancy(int rows, int cols) : occupied(rows), rows(rows), cols(cols) {}
+  int nrows() { return rows; }
+  int ncols() { return cols; }
+  bool check_within(int row, int col) { return row >= 0 && col >= 0 && row < rows && col < cols; }
+  Geodata get_geodata() { return geodata; }
+  void set_geodata(Geodata geodata) { this->geodata = geodata; }
+  GeographicCoordinate get_origin() { return {geodata.geotransform[3], geodata.geotransform[0]}; }
+  GeographicCoordinate get_coordinate(int row, int col) {
+    return {geodata.geotransform[3] + ((double)row + 0.5) * geodata.geotransform[5],
+            geodata.geotransform[0] + ((double)col + 0.5) * geodata.geotransform[1]};
+  }
+
+  bool get(int row, int col);
+  bool overlaps(const Footprint &footprint);
+  void add(Run run);
+  void add(const Footprint &footprint);
+  void clear();
+
+  // Calls f(start, end) for each stretch of the run's cells that are occupied, in order
+  template <class F> void for_each_overlap(Run run, F f) {
+    if (run.row < 0 || run.row >= rows)
+      return;
+    vector<pair<int, int>> &row = occupied[run.row];
+    auto it = upper_bound(row.begin(), row.end(), pair<int, int>(run.start, INT_MAX));
+    if (it != row.begin() && prev(it)->second > run.start)
+      it--;
+    for (; it != row.end() && it->first < run.end; it++)
+      f(MAX(it->first, run.start), MIN(it->second, run.end));
+  }
+
+private:
+  vector<vector<pair<int, int>>> occupied; // [start, end) for each row
+  vector<int> dirty_rows;                    // The rows with runs
+  int rows;
+  int cols;
+  Geodata geodata;
+};
+
+#endif
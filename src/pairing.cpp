@@ -1,31 +1,33 @@
 #include "coordinates.h"
 #include "phes_base.h"
+#include "point_index.hpp"
 #include "reservoir.h"
 #include "search_config.hpp"
+#include "stages.hpp"
 
-vector<ExistingPit> pit_details;
-ExistingPit single_pit_details;
-
-vector<int> pairs;
+thread_local vector<ExistingPit> pit_details;
+thread_local ExistingPit single_pit_details;
 
 vector<GeographicCoordinate> find_points_to_test(RoughReservoir* &reservoir,
-                                                 double &wall_height, ArrayCoordinate &pour_point) {
+                                                 double &wall_height, ArrayCoordinate &pour_point,
+                                                 const SearchParameters &params) {
   vector<GeographicCoordinate> bound;
   if (RoughGreenfieldReservoir *gr = dynamic_cast<RoughGreenfieldReservoir *>(reservoir)) {
-    array<ArrayCoordinate, directions.size()> one_point = {pour_point, pour_point, pour_point,
-                                                           pour_point, pour_point, pour_point,
-                                                           pour_point, pour_point};
+    GeographicCoordinate origin = reservoir->pour_point.origin;
+    array<GridPoint, directions.size()> one_point;
+    one_point.fill({pour_point.row, pour_point.col});
     int i = 0;
-    while (dam_wall_heights[i] < wall_height) {
+    while (params.dam_wall_heights[i] < wall_height) {
       i += 1;
     }
-    int lower_wall_height = (i) ? dam_wall_heights[i - 1] : 0;
-    array<ArrayCoordinate, directions.size()> lower_shape =
+    int lower_wall_height = (i) ? params.dam_wall_heights[i - 1] : 0;
+    array<GridPoint, directions.size()> &lower_shape =
         (i) ? gr->shape_bound[i - 1] : one_point;
     double inv_wall_height_interval = 0.1;
     for (uint j = 0; j < directions.size(); j++) {
-      GeographicCoordinate point1 = convert_coordinates(lower_shape[j]);
-      GeographicCoordinate point2 = convert_coordinates(gr->shape_bound[i][j]);
+      GeographicCoordinate point1 = convert_coordinates(ArrayCoordinate_init(lower_shape[j], origin));
+      GeographicCoordinate point2 =
+          convert_coordinates(ArrayCoordinate_init(gr->shape_bound[i][j], origin));
       bound.push_back((GeographicCoordinate){
           point1.lat + (point2.lat - point1.lat) * (wall_height - lower_wall_height) *
                            inv_wall_height_interval,
@@ -35,20 +37,21 @@ vector<GeographicCoordinate> find_points_to_test(RoughReservoir* &reservoir,
     bound.push_back(convert_coordinates(pour_point));
   } else {
     RoughBfieldReservoir *br = dynamic_cast<RoughBfieldReservoir *>(reservoir);
-    for (ArrayCoordinate c : br->shape_bound)
-      bound.push_back(convert_coordinates(c));
+    for (GridPoint c : br->shape_bound)
+      bound.push_back(convert_coordinates(ArrayCoordinate_init(c, br->pour_point.origin)));
   }
   return bound;
 }
 
 double find_least_distance_sqd(RoughReservoir* upper, RoughReservoir* &lower,
                                double upper_wall_height, double lower_wall_height,
-                               ArrayCoordinate* upper_pour_point, ArrayCoordinate* lower_pour_point) {
+                               ArrayCoordinate* upper_pour_point, ArrayCoordinate* lower_pour_point,
+                               const SearchParameters &params) {
   double mindist2 = INF;
   vector<GeographicCoordinate> upper_points =
-      find_points_to_test(upper, upper_wall_height, *upper_pour_point);
+      find_points_to_test(upper, upper_wall_height, *upper_pour_point, params);
   vector<GeographicCoordinate> lower_points =
-      find_points_to_test(lower, lower_wall_height, *lower_pour_point);
+      find_points_to_test(lower, lower_wall_height, *lower_pour_point, params);
 
   for (uint iu = 0; iu < upper_points.size(); iu++) {
     GeographicCoordinate p1 = upper_points[iu];
@@ -101,7 +104,8 @@ bool determine_pit_elevation_and_volume(RoughReservoir* &upper,
                                         RoughReservoir* &lower,
                                         double energy_capacity,
                                         ExistingPit &pit_details_single,
-                                        double &required_volume, int &head) {
+                                        double &required_volume, int &head,
+                                        const SearchParameters &params) {
   RoughReservoir* greenfield = upper;
   RoughReservoir* pit = lower;
   if (upper->brownfield) {
@@ -117,11 +121,11 @@ bool determine_pit_elevation_and_volume(RoughReservoir* &upper,
       double volume =
           pit_volume(pit_details_single, pit->elevation, pit->elevation + pit_depth);
       double greenfield_wall_height =
-          linear_interpolate(volume, greenfield->volumes, dam_wall_heights);
+          linear_interpolate(volume, greenfield->volumes, params.dam_wall_heights);
       head = convert_to_int(ABS(((0.5 * (double)greenfield_wall_height +
                         (double)greenfield->elevation) -
                        (0.5 * (double)pit_depth + (double)pit->elevation))));
-      if (head < min_head || head > max_head)
+      if (head < params.min_head || head > params.max_head)
         continue;
       double head_ratio =
           (head + 0.5 * (greenfield_wall_height + (double)pit_depth)) /
@@ -130,29 +134,31 @@ bool determine_pit_elevation_and_volume(RoughReservoir* &upper,
       // greenfield->elevation << " " << pit_depth << " " << pit->elevation << " "
       // << head << " " << head_ratio << "\n";
 
-      if (head_ratio > (1 + max_head_variability)) {
+      if (head_ratio > (1 + params.max_head_variability)) {
         break;
       }
 
-      if (volume < find_required_volume(energy_capacity, head)) {
+      if (volume < find_required_volume(energy_capacity, head, params)) {
         continue;
       }
       required_volume = volume;
       return true;
     }
 
-    pit->elevation += pit_height_resolution;
+    pit->elevation += params.pit_height_resolution;
   }
   return false;
 }
 
 Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
                       double energy_capacity, int storage_time, Pair *pair,
-                      int max_FOM) {
+                      int max_FOM, const SearchParameters &params) {
+  metrics.count(PAIRS_TESTED);
   int head = upper->elevation - lower->elevation;
-  double required_volume = find_required_volume(energy_capacity, head);
+  double required_volume = find_required_volume(energy_capacity, head, params);
   if ((max(upper->volumes) < required_volume) ||
       (max(lower->volumes) < required_volume * (lower->river ? 5 : 1))) {
+    metrics.count(PRUNED_VOLUME);
     return NULL;
   }
   ExistingPit single_pit;
@@ -175,8 +181,8 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
           pit_id = upper->identifier;
         else
           pit_id = lower->identifier;
-        search_config.logger.debug("No pit details in existing_reservoirs_csv for reservoir with ID: " + pit_id);
-        exit(1);
+        search_config.logger.debug("No pit details in existing_reservoirs_csv for reservoir with ID: ", pit_id);
+        throw(1);
       }
     }
   } else if (search_config.search_type == SearchType::SINGLE_PIT) {
@@ -185,7 +191,8 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
 
   if (search_config.search_type == SearchType::BULK_PIT || search_config.search_type == SearchType::SINGLE_PIT) {
     if (!determine_pit_elevation_and_volume(upper, lower, energy_capacity,
-                                          single_pit, required_volume, head)) {
+                                          single_pit, required_volume, head, params)) {
+      metrics.count(PRUNED_PIT);
       return NULL;
     }
   }
@@ -197,10 +204,10 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
 
   if (!upper->brownfield) {
     upper_dam_wall_height =
-        linear_interpolate(required_volume, upper->volumes, dam_wall_heights);
+        linear_interpolate(required_volume, upper->volumes, params.dam_wall_heights);
     upper_water_rock_estimate =
         required_volume / linear_interpolate(upper_dam_wall_height,
-                                             dam_wall_heights,
+                                             params.dam_wall_heights,
                                              upper->dam_volumes);
   } else {
     if (search_config.search_type == SearchType::BULK_PIT || search_config.search_type == SearchType::SINGLE_PIT)
@@ -212,16 +219,16 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
                              int_to_double_vector(get_altitudes(single_pit))) -
           upper->elevation;
     else
-      upper_dam_wall_height = dam_wall_heights[0];
+      upper_dam_wall_height = params.dam_wall_heights[0];
     upper_water_rock_estimate = INF;
   }
 
   if (!lower->brownfield && !lower->ocean) {
     lower_dam_wall_height =
-        linear_interpolate(required_volume, lower->volumes, dam_wall_heights);
+        linear_interpolate(required_volume, lower->volumes, params.dam_wall_heights);
     lower_water_rock_estimate =
         required_volume / linear_interpolate(lower_dam_wall_height,
-                                             dam_wall_heights,
+                                             params.dam_wall_heights,
                                              lower->dam_volumes);
   } else {
     if (search_config.search_type==SearchType::BULK_PIT || search_config.search_type == SearchType::SINGLE_PIT)
@@ -234,19 +241,21 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
                              int_to_double_vector(get_altitudes(single_pit))) -
           lower->elevation;
     else
-      lower_dam_wall_height = dam_wall_heights[0];
+      lower_dam_wall_height = params.dam_wall_heights[0];
     lower_water_rock_estimate = INF;
   }
 
   if ((!upper->brownfield && upper_dam_wall_height > upper->max_dam_height) ||
       (!lower->brownfield && !lower->ocean &&
        lower_dam_wall_height > lower->max_dam_height)) {
+    metrics.count(PRUNED_DAM_HEIGHT);
     return NULL;
   }
 
   if ((upper_water_rock_estimate * lower_water_rock_estimate) <
-      min_pair_water_rock *
+      params.min_pair_water_rock *
           (upper_water_rock_estimate + lower_water_rock_estimate)) {
+    metrics.count(PRUNED_WATER_ROCK);
     return NULL;
   }
 
@@ -255,9 +264,10 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
 
   double least_distance = find_least_distance_sqd(
       upper, lower, upper_dam_wall_height,
-      lower_dam_wall_height, &upper_coordinates, &lower_coordinates);
+      lower_dam_wall_height, &upper_coordinates, &lower_coordinates, params);
 
-  if (SQ(head * 0.001) < least_distance * SQ(min_slope)) {
+  if (SQ(head * 0.001) < least_distance * SQ(params.min_slope)) {
+    metrics.count(PRUNED_SLOPE);
     return NULL;
   }
 
@@ -273,9 +283,9 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
 
   if (!upper->brownfield) {
     upper_reservoir.dam_volume = linear_interpolate(
-        upper_dam_wall_height, dam_wall_heights, upper->dam_volumes);
+        upper_dam_wall_height, params.dam_wall_heights, upper->dam_volumes);
     upper_reservoir.area = linear_interpolate(upper_dam_wall_height,
-                                              dam_wall_heights, upper->areas);
+                                              params.dam_wall_heights, upper->areas);
   } else {
     upper_reservoir.area = upper->areas[0];
   }
@@ -291,9 +301,9 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
 
   if (!lower->brownfield) {
     lower_reservoir.dam_volume = linear_interpolate(
-        lower_dam_wall_height, dam_wall_heights, lower->dam_volumes);
+        lower_dam_wall_height, params.dam_wall_heights, lower->dam_volumes);
     lower_reservoir.area = linear_interpolate(lower_dam_wall_height,
-                                              dam_wall_heights, lower->areas);
+                                              params.dam_wall_heights, lower->areas);
   } else {
     lower_reservoir.area = lower->areas[0];
   }
@@ -319,31 +329,50 @@ Pair *check_good_pair(RoughReservoir* upper, RoughReservoir* lower,
   pair->water_rock =
       1 / (1 / pair->upper.water_rock + 1 / pair->lower.water_rock);
 
-  set_FOM(pair);
+  set_FOM(pair, params);
 
-  if (pair->FOM > max_FOM)
+  if (pair->FOM > max_FOM) {
+    metrics.count(PRUNED_FOM);
     return NULL;
+  }
   return pair;
 }
 
+static vector<ArrayCoordinate> shape_bound_points(RoughBfieldReservoir *reservoir) {
+  vector<ArrayCoordinate> points;
+  points.reserve(reservoir->shape_bound.size());
+  for (GridPoint p : reservoir->shape_bound)
+    points.push_back(ArrayCoordinate_init(p, reservoir->pour_point.origin));
+  return points;
+}
+
 void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
-             vector<unique_ptr<RoughReservoir>> &lower_reservoirs, FILE *csv_file,
-             FILE *csv_data_file, bool existing_existing_allowed=false) {
+             vector<unique_ptr<RoughReservoir>> &lower_reservoirs,
+             const function<void(Pair &)> &found, vector<int> &pairs,
+             bool existing_existing_allowed,
+             const SearchParameters &params) {
+  ScopedTimer timer("pairing");
   vector<set<Pair>> temp_pairs;
-  for (uint itest = 0; itest < tests.size(); itest++) {
+  for (uint itest = 0; itest < params.tests.size(); itest++) {
     pairs.push_back(0);
     set<Pair> a;
     temp_pairs.push_back(a);
   }
 
+  // The outlines of existing reservoirs and the ocean, indexed when first paired
+  vector<unique_ptr<PointIndex>> lower_bounds(lower_reservoirs.size());
   for (uint iupper = 0; iupper < upper_reservoirs.size(); iupper++) {
     RoughReservoir* upper_reservoir = upper_reservoirs[iupper].get();
     double coslat = COS(RADIANS(upper_reservoir->latitude));
+    unique_ptr<PointIndex> upper_bound;
+    if (upper_reservoir->brownfield)
+      upper_bound.reset(
+          new PointIndex(shape_bound_points(static_cast<RoughBfieldReservoir *>(upper_reservoir))));
     for (uint ilower = 0; ilower < lower_reservoirs.size(); ilower++) {
       RoughReservoir* lower_reservoir = lower_reservoirs[ilower].get();
       int head = upper_reservoir->elevation - lower_reservoir->elevation;
       if (!upper_reservoir->river && !lower_reservoir->river)
-        if (head < min_head || head > max_head)
+        if (head < params.min_head || head > params.max_head)
           continue;
 
       if (!existing_existing_allowed && upper_reservoir->brownfield && lower_reservoir->brownfield)
@@ -355,31 +384,19 @@ void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
 
       if(upper_reservoir->brownfield){
         min_dist_sqd = INF;
-        RoughBfieldReservoir* br = static_cast<RoughBfieldReservoir*>(upper_reservoir);
-        for(size_t i = 0; i<br->shape_bound.size(); i++){
-          ArrayCoordinate ac = br->shape_bound[i];
-          double dist_sqd = find_distance_sqd(ac, lower_reservoir->pour_point, coslat);
-          if(dist_sqd < min_dist_sqd){
-            min_dist_sqd = dist_sqd;
-          }
-        }
+        upper_bound->closest_sqd(lower_reservoir->pour_point, coslat, min_dist_sqd);
       }
       if(lower_reservoir->brownfield || lower_reservoir->ocean){
         min_dist_sqd = INF;
         RoughBfieldReservoir* lr = static_cast<RoughBfieldReservoir*>(lower_reservoir);
 
-        int idx = 0;
-        for(size_t i = 0; i<lr->shape_bound.size(); i++){
-          ArrayCoordinate ac = lr->shape_bound[i];
-          double dist_sqd = find_distance_sqd(ac, upper_reservoir->pour_point, coslat);
-          if(dist_sqd < min_dist_sqd){
-            idx = i;
-            min_dist_sqd = dist_sqd;
-          }
-        }
+        if(!lower_bounds[ilower])
+          lower_bounds[ilower].reset(new PointIndex(shape_bound_points(lr)));
+        int idx = MAX(lower_bounds[ilower]->closest_sqd(upper_reservoir->pour_point, coslat,
+                                                        min_dist_sqd), 0);
         if(lower_reservoir->river){
           lower_reservoir->elevation = lr->elevations[idx];
-          lower_reservoir->pour_point = lr->shape_bound[idx];
+          lower_reservoir->pour_point = ArrayCoordinate_init(lr->shape_bound[idx], lr->pour_point.origin);
         }
       }
 
@@ -387,26 +404,26 @@ void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
         continue;
 
       head = upper_reservoir->elevation - lower_reservoir->elevation;
-      if (head < min_head || head > max_head)
+      if (head < params.min_head || head > params.max_head)
         continue;
 
-      if (SQ(head * 0.001) <= min_dist_sqd * SQ(min_pp_slope))
+      if (SQ(head * 0.001) <= min_dist_sqd * SQ(params.min_pp_slope))
         continue;
 
 
-      for (uint itest = 0; itest < tests.size(); itest++) {
+      for (uint itest = 0; itest < params.tests.size(); itest++) {
         Pair temp_pair;
         int max_FOM =
-            (category_cutoffs[0].storage_cost * tests[itest].storage_time +
-             category_cutoffs[0].power_cost) *
-            (1 + tolerance_on_FOM);
+            (params.category_cutoffs[0].storage_cost * params.tests[itest].storage_time +
+             params.category_cutoffs[0].power_cost) *
+            (1 + params.tolerance_on_FOM);
 
         if (check_good_pair(upper_reservoir, lower_reservoir,
-                            tests[itest].energy_capacity,
-                            tests[itest].storage_time, &temp_pair, max_FOM)) {
+                            params.tests[itest].energy_capacity,
+                            params.tests[itest].storage_time, &temp_pair, max_FOM, params)) {
           temp_pairs[itest].insert(temp_pair);
 
-          if ((int)temp_pairs[itest].size() > max_lowers_per_upper ||
+          if ((int)temp_pairs[itest].size() > params.max_lowers_per_upper ||
               ((search_config.search_type == SearchType::BULK_PIT || search_config.search_type == SearchType::SINGLE_PIT)&&
               temp_pairs[itest].size() > 1))
             temp_pairs[itest].erase(prev(temp_pairs[itest].end()));
@@ -414,10 +431,9 @@ void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
       }
     }
 
-    for (uint itest = 0; itest < tests.size(); itest++) {
+    for (uint itest = 0; itest < params.tests.size(); itest++) {
       for (Pair pair : temp_pairs[itest]) {
-        write_rough_pair_csv(csv_file, &pair);
-        write_rough_pair_data(csv_data_file, &pair);
+        found(pair);
         pairs[itest]++;
       }
       temp_pairs[itest].clear();
@@ -425,13 +441,13 @@ void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
   }
 }
 
-int main(int nargs, char **argv) {
-  search_config = SearchConfig(nargs, argv);
+int run_pairing() {
+  search_config.logger.set_stage("pairing");
+  metrics.reset();
   cout << "Pairing started for " << search_config.filename() << endl;
+  const SearchParameters params = SearchParameters::from_variables();
 
   unsigned long t_usec = walltime_usec();
-  parse_variables(convert_string("storage_location"));
-  parse_variables(convert_string(file_storage_location + "variables"));
 
   vector<unique_ptr<RoughReservoir>> upper_reservoirs;
   vector<unique_ptr<RoughReservoir>> lower_reservoirs;
@@ -488,14 +504,14 @@ int main(int nargs, char **argv) {
         lower_reservoirs.push_back(std::move(temp[j]));
       }
     } catch (int e) {
-      search_config.logger.debug("Could not import reservoirs from " + file_storage_location +
-                                 "processing_files/reservoirs/" +
-                                 search_config.search_type.lowers_prefix() + str(neighbors[i]) +
+      search_config.logger.debug("Could not import reservoirs from ", file_storage_location,
+                                 "processing_files/reservoirs/",
+                                 search_config.search_type.lowers_prefix(), str(neighbors[i]),
                                  "_reservoirs_data.csv");
     }
   }
-  search_config.logger.debug("Read in "+to_string(upper_reservoirs.size())+" uppers");
-  search_config.logger.debug("Read in " + to_string(lower_reservoirs.size()) + " lowers");
+  search_config.logger.debug("Read in ", upper_reservoirs.size(), " uppers");
+  search_config.logger.debug("Read in ", lower_reservoirs.size(), " lowers");
 
   mkdir(convert_string(file_storage_location + "output/pairs"), 0777);
   FILE *csv_file =
@@ -504,7 +520,7 @@ int main(int nargs, char **argv) {
             "w");
   if (!csv_file) {
     fprintf(stderr, "Failed to open reservoir pair CSV file\n");
-    exit(1);
+    throw(1);
   }
   write_rough_pair_csv_header(csv_file);
 
@@ -515,27 +531,38 @@ int main(int nargs, char **argv) {
             "w");
   if (!csv_data_file) {
     fprintf(stderr, "Failed to open reservoir pair CSV data file\n");
-    exit(1);
+    throw(1);
   }
   write_rough_pair_data_header(csv_data_file);
 
-  pairing(upper_reservoirs, lower_reservoirs, csv_file, csv_data_file, true);
+  CSVWriter csv(csv_file), csv_data(csv_data_file);
+  auto write_pair = [&](Pair &pair) {
+    write_rough_pair_csv(csv, &pair);
+    write_rough_pair_data(csv_data, &pair);
+  };
+  vector<int> pairs;
+  pairing(upper_reservoirs, lower_reservoirs, write_pair, pairs, true, params);
   if (search_config.search_type.existing())
-    pairing(lower_reservoirs, upper_reservoirs, csv_file, csv_data_file);
+    pairing(lower_reservoirs, upper_reservoirs, write_pair, pairs, false, params);
+  csv.flush();
+  csv_data.flush();
 
   int total = 0;
-  for (uint itest = 0; itest < tests.size(); itest++) {
-    search_config.logger.debug(to_string(pairs[itest]) + " " +
-                               to_string(tests[itest].energy_capacity) +
-                               "GWh " + to_string(tests[itest].storage_time) +
-                               "h pairs");
+  for (uint itest = 0; itest < params.tests.size(); itest++) {
+    search_config.logger.debug(pairs[itest], " ", params.tests[itest].energy_capacity, "GWh ",
+                               params.tests[itest].storage_time, "h pairs");
     total += pairs[itest];
   }
 
+  count_file_written(csv_file);
+  count_file_written(csv_data_file);
   fclose(csv_file);
   fclose(csv_data_file);
 
+  search_config.logger.flush();
   cout << "Pairing finished for " << search_config.filename() << ". Found "
        << total << " pairs. Runtime: " << 1.0e-6 * (walltime_usec() - t_usec)
        << " sec" << endl;
+  write_metrics("pairing");
+  return 0;
 }
@@ -1,7 +1,9 @@
 #include "phes_base.h"
+#include "cell_sizes.hpp"
 #include "coordinates.h"
 #include "model2D.h"
 #include "reservoir.h"
+#include "reservoir_cache.hpp"
 #include "search_config.hpp"
 #include <shapefil.h>
 #include <string>
@@ -23,14 +25,14 @@ double max(vector<double> a)
 	return amax;
 }
 
-double convert_to_dam_volume(int height, double length)
+double convert_to_dam_volume(int height, double length, const SearchParameters &params)
 {
-	return (((height+freeboard)*(cwidth+dambatter*(height+freeboard)))/1000000)*length;
+	return (((height+params.freeboard)*(params.cwidth+params.dambatter*(height+params.freeboard)))/1000000)*length;
 }
 
-double convert_to_dam_volume(double height, double length)
+double convert_to_dam_volume(double height, double length, const SearchParameters &params)
 {
-	return (((height+freeboard)*(cwidth+dambatter*(height+freeboard)))/1000000)*length;
+	return (((height+params.freeboard)*(params.cwidth+params.dambatter*(height+params.freeboard)))/1000000)*length;
 }
 
 double linear_interpolate(double value, vector<double> x_values, vector<double> y_values)
@@ -65,9 +67,9 @@ unsigned long walltime_usec()
 	return (1000000*now.tv_sec + now.tv_usec);
 }
 
-double find_required_volume(int energy, int head)
+double find_required_volume(int energy, int head, const SearchParameters &params)
 {
-	return (((double)(energy)*J_GWh_conversion)/((double)(head)*water_density*gravity*generation_efficiency*usable_volume*cubic_metres_GL_conversion));
+	return (((double)(energy)*J_GWh_conversion)/((double)(head)*params.water_density*params.gravity*params.generation_efficiency*params.usable_volume*cubic_metres_GL_conversion));
 }
 
 char* convert_string(const string& str){
@@ -84,6 +86,7 @@ string dtos(double f, int nd) {
 }
 
 Model<short>* read_DEM_with_borders(GridSquare sc, int border){
+	ScopedTimer timer("read_DEM");
 	Model<short>* DEM = new Model<short>(0, 0, MODEL_UNSET);
 	const int neighbors[9][4][2] = {
 		//[(Tile coordinates) , (Tile base)		 		  , (Tile limit)				  , (Tile offset)	 	       ]
@@ -124,7 +127,7 @@ Model<short>* read_DEM_with_borders(GridSquare sc, int border){
 }
 
 
-BigModel BigModel_init(GridSquare sc){
+BigModel BigModel_init(GridSquare sc, Model<char> *flow_directions[9]){
 	BigModel big_model;
 	GridSquare neighbors[9] = {
 		(GridSquare){sc.lat  ,sc.lon  },
@@ -140,10 +143,23 @@ BigModel BigModel_init(GridSquare sc){
 		big_model.neighbors[i] = neighbors[i];
 	}
 	big_model.DEM = read_DEM_with_borders(sc, 3600);
+	big_model.DEM_cell_sizes = new CellSizes(big_model.DEM->get_origin(), big_model.DEM->nrows());
+	for(int i = 0; i<9; i++){
+		big_model.flow_directions[i] = flow_directions[i];
+		big_model.cell_sizes[i] = flow_directions[i] ? new CellSizes(flow_directions[i]->get_origin(), flow_directions[i]->nrows()) : NULL;
+	}
+	big_model.reservoir_cache = new ReservoirCache();
+	return big_model;
+}
+
+BigModel BigModel_init(GridSquare sc){
+	Model<char> *flow_directions[9] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+	BigModel big_model = BigModel_init(sc, flow_directions);
 	for(int i = 0; i<9; i++){
 		GridSquare gs = big_model.neighbors[i];
 		try{
 			big_model.flow_directions[i] = new Model<char>(file_storage_location+"processing_files/flow_directions/"+str(gs)+"_flow_directions.tif",GDT_Byte);
+			big_model.cell_sizes[i] = new CellSizes(big_model.flow_directions[i]->get_origin(), big_model.flow_directions[i]->nrows());
 		}catch(int e){
 			search_config.logger.debug("Could not find " + str(gs));
 		}
@@ -151,35 +167,50 @@ BigModel BigModel_init(GridSquare sc){
 	return big_model;
 }
 
-double calculate_power_house_cost(double power, double head){
-	return powerhouse_coeff*pow(MIN(power,800),(power_exp))/pow(head,head_exp);
+void BigModel_free(BigModel &big_model){
+	delete big_model.DEM;
+	big_model.DEM = NULL;
+	delete big_model.DEM_cell_sizes;
+	big_model.DEM_cell_sizes = NULL;
+	for(int i = 0; i<9; i++){
+		delete big_model.flow_directions[i];
+		big_model.flow_directions[i] = NULL;
+		delete big_model.cell_sizes[i];
+		big_model.cell_sizes[i] = NULL;
+	}
+	delete big_model.reservoir_cache;
+	big_model.reservoir_cache = NULL;
+}
+
+double calculate_power_house_cost(double power, double head, const SearchParameters &params){
+	return params.powerhouse_coeff*pow(MIN(power,800),(params.power_exp))/pow(head,params.head_exp);
 }
 
-double calculate_tunnel_cost(double power, double head, double seperation){
-	return ((power_slope_factor*MIN(power,800)+slope_int)*pow(head,head_coeff)*seperation*1000)+(power_offset*MIN(power,800)+tunnel_fixed);
+double calculate_tunnel_cost(double power, double head, double seperation, const SearchParameters &params){
+	return ((params.power_slope_factor*MIN(power,800)+params.slope_int)*pow(head,params.head_coeff)*seperation*1000)+(params.power_offset*MIN(power,800)+params.tunnel_fixed);
 }
 
-void set_FOM(Pair* pair){
+void set_FOM(Pair* pair, const SearchParameters &params){
 	double seperation = pair->distance;
 	double head = (double)pair->head;
 	double power = 1000*pair->energy_capacity/pair->storage_time;
-	double energy_cost = dam_cost*1/(pair->water_rock*generation_efficiency * usable_volume*water_density*gravity*head)*J_GWh_conversion/cubic_metres_GL_conversion;
+	double energy_cost = params.dam_cost*1/(pair->water_rock*params.generation_efficiency * params.usable_volume*params.water_density*params.gravity*head)*J_GWh_conversion/cubic_metres_GL_conversion;
 	double power_cost;
 	double tunnel_cost;
 	double power_house_cost;
 	if (head > 800) {
-		power_house_cost = 2*calculate_power_house_cost(power/2, head/2);
-		tunnel_cost = 2*calculate_tunnel_cost(power/2, head/2, seperation);
+		power_house_cost = 2*calculate_power_house_cost(power/2, head/2, params);
+		tunnel_cost = 2*calculate_tunnel_cost(power/2, head/2, seperation, params);
 		power_cost = 0.001*(power_house_cost+tunnel_cost)/MIN(power, 800);
 	}
 	else {
-		power_house_cost = calculate_power_house_cost(power, head);
-		tunnel_cost = calculate_tunnel_cost(power, head, seperation);
+		power_house_cost = calculate_power_house_cost(power, head, params);
+		tunnel_cost = calculate_tunnel_cost(power, head, seperation, params);
 		power_cost = 0.001*(power_house_cost+tunnel_cost)/MIN(power, 800);
 		if(pair->lower.ocean){
-			double total_lining_cost = lining_cost*pair->upper.area*meters_per_hectare;
-			power_house_cost = power_house_cost*sea_power_scaling;
-			double marine_outlet_cost = ref_marine_cost*power*ref_head/(ref_power*head);
+			double total_lining_cost = params.lining_cost*pair->upper.area*meters_per_hectare;
+			power_house_cost = power_house_cost*params.sea_power_scaling;
+			double marine_outlet_cost = params.ref_marine_cost*power*params.ref_head/(params.ref_power*head);
 			power_cost = 0.001*((power_house_cost+tunnel_cost)/MIN(power, 800) + marine_outlet_cost/power);
 			energy_cost += 0.000001*total_lining_cost/pair->energy_capacity;
 		}
@@ -188,8 +219,8 @@ void set_FOM(Pair* pair){
 	pair->FOM = power_cost+energy_cost*pair->storage_time;
 	pair->category = 'Z';
 	uint i = 0;
-	while(i<category_cutoffs.size() && pair->FOM<category_cutoffs[i].power_cost+pair->storage_time*category_cutoffs[i].storage_cost){
-		pair->category = category_cutoffs[i].category;
+	while(i<params.category_cutoffs.size() && pair->FOM<params.category_cutoffs[i].power_cost+pair->storage_time*params.category_cutoffs[i].storage_cost){
+		pair->category = params.category_cutoffs[i].category;
 		i++;
 	}
 }
@@ -460,8 +491,11 @@ RoughBfieldReservoir existing_reservoir_to_rough_reservoir(ExistingReservoir r)
   }
 
 	GeographicCoordinate origin = get_origin(r.latitude, r.longitude, border);
-	for(GeographicCoordinate c : r.polygon)
-    reservoir.shape_bound.push_back(convert_coordinates(c, origin));
+  reservoir.pour_point = convert_coordinates(GeographicCoordinate_init(r.latitude, r.longitude), origin);
+	for(GeographicCoordinate c : r.polygon) {
+    ArrayCoordinate ac = convert_coordinates(c, origin);
+    reservoir.shape_bound.push_back({ac.row, ac.col});
+  }
 	return reservoir;
 }
 
@@ -517,6 +551,7 @@ void depression_volume_finding(Model<short>* DEM) {
 		SHPGetInfo(SHP, &nEntities, NULL, NULL, NULL);
 
 		SHPObject *shape;
+		CellSizes cell_sizes(DEM->get_origin(), DEM->nrows());
 
 		for(int i = 0; i<nEntities; i++){
 			Model<bool>* extent = new Model<bool>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
@@ -537,7 +572,7 @@ void depression_volume_finding(Model<short>* DEM) {
 			}
 			if (idx < 0) {
 				search_config.logger.debug("Could not find reservoir with id " + names[i]);
-        exit(1);
+        throw(1);
 			}
 
 			ExistingReservoir reservoir = reservoirs[idx];
@@ -583,7 +618,7 @@ void depression_volume_finding(Model<short>* DEM) {
 			for(int row = 0; row<extent->nrows(); row++)
 				for(int col = 0; col<extent->ncols(); col++)
 					if(extent->get(row, col)){
-						area_at_elevation[min_elevation + 1] += find_area(ArrayCoordinate_init(row, col, DEM->get_origin()));
+						area_at_elevation[min_elevation + 1] += cell_sizes.area({row, col});
 					}
 
 			// Find the surface area and volume of reservoir at each elevation above pour point
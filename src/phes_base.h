@@ -10,6 +10,7 @@
 
 #include <bits/stdc++.h>
 
+#include "metrics.hpp"
 #include "search_config.hpp"
 
 using namespace std;
@@ -32,6 +33,13 @@ extern string existing_reservoirs_shp;
 extern string existing_reservoirs_shp_names;
 extern bool use_tiled_bluefield;
 extern bool use_tiled_rivers;
+extern int driver_threads; // Worker threads for the in-process scheduler (0 uses
+                           // lockfiles and ./bin/<process>)
+extern bool driver_dag;    // Start each task once its dependencies are done instead of waiting
+                           // for each process to finish
+extern bool longest_first; // Run the tasks with the longest predicted runtime first instead of
+                           // in file order
+extern int stage_threads;  // Threads used within pretty_set and the constructor for each task
 
 // General
 extern string file_storage_location; // Where to look for input files and store
@@ -150,6 +158,8 @@ struct CategoryCutoff {
 
 extern vector<CategoryCutoff> category_cutoffs;
 
+#include "search_parameters.hpp"
+
 #ifndef MIN
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #endif
@@ -176,10 +186,16 @@ bool file_exists(string name);
 
 #include "coordinates.h"
 
+class ReservoirCache;
+class CellSizes;
+
 struct BigModel {
   GridSquare neighbors[9];
   Model<short> *DEM;
   Model<char> *flow_directions[9];
+  CellSizes *DEM_cell_sizes;
+  CellSizes *cell_sizes[9]; // For each of flow_directions
+  ReservoirCache *reservoir_cache; // The floods of the reservoirs modelled so far
 };
 
 
@@ -192,20 +208,24 @@ struct BigModel {
 
 int convert_to_int(double f);
 double max(vector<double> a);
-double convert_to_dam_volume(int height, double length);
-double convert_to_dam_volume(int height, double length);
+double convert_to_dam_volume(int height, double length, const SearchParameters &params);
+double convert_to_dam_volume(int height, double length, const SearchParameters &params);
 double linear_interpolate(double value, vector<double> x_values,
                           vector<double> y_values);
 string str(int i);
 unsigned long walltime_usec();
-double find_required_volume(int energy, int head);
+double find_required_volume(int energy, int head, const SearchParameters &params);
 char *convert_string(const string& str);
 void write_to_csv_file(FILE *csv_file, vector<string> cols);
 vector<string> read_from_csv_file(string line);
 string dtos(double f, int nd);
 Model<short> *read_DEM_with_borders(GridSquare sq, int border);
 BigModel BigModel_init(GridSquare sc);
-void set_FOM(Pair *pair);
+// Uses flow directions already in memory (in neighbors order, NULL where missing) rather than
+// reading them from processing_files. BigModel_free deletes them with the rest of the model.
+BigModel BigModel_init(GridSquare sc, Model<char> *flow_directions[9]);
+void BigModel_free(BigModel &big_model);
+void set_FOM(Pair *pair, const SearchParameters &params);
 string str(Test test);
 string energy_capacity_to_string(double energy_capacity);
 GeographicCoordinate get_origin(double latitude, double longitude, int border);
@@ -0,0 +1,130 @@
+#include "phes_base.h"
+#include <atomic>
+#include "stages.hpp"
+#include "synthetic_dem.hpp"
+
+// Benchmarks screening, pairing and pretty_set on synthetic terrain, so changes in performance can
+// be measured without the SRTM inputs. The tiles for a seed and DEM square are written once to
+// <storage location>/bench/seed_<seed>_<square>/input/DEMs and reused by later runs with the same
+// arguments.
+//   ./bin/phes_bench [seed] [<lon> <lat>]
+
+// Heap allocations made while each stage runs, counted by replacing the global operator new
+static atomic<long> allocations(0);
+
+void *operator new(size_t size) {
+  allocations.fetch_add(1, memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static void print_rate(string stage, double count, string unit, double seconds) {
+  printf("  %-24s %12.0f %-6s %9.2f sec %14.0f %s/s\n", convert_string(stage), count,
+         convert_string(unit), seconds, seconds > 0 ? count / seconds : 0.0, convert_string(unit));
+}
+
+// Rates for each step timed while the stage ran, where each step handles cells_per_call cells
+static void print_step_rates(double cells_per_call) {
+  for (auto &[name, total] : metrics.timers)
+    print_rate(name, cells_per_call * total.calls, "cells", total.seconds);
+}
+
+int main(int nargs, char **argv) {
+  uint64_t seed = nargs > 1 ? strtoull(argv[1], NULL, 10) : 1;
+  GridSquare sc = GridSquare_init(-36, 148);
+  if (nargs > 3)
+    sc = GridSquare_init(atoi(argv[3]), atoi(argv[2]));
+
+  GDALAllRegister();
+  parse_variables(convert_string("storage_location"));
+  parse_variables(convert_string(file_storage_location + "variables"));
+  SearchParameters params = SearchParameters::from_variables();
+  // The filters are for real locations
+  params.filter_filenames.clear();
+
+  file_storage_location += "bench/";
+  mkdir(convert_string(file_storage_location), 0777);
+  // The terrain is laid out around the DEM square, so tiles are only shared between runs for the
+  // same square
+  file_storage_location += "seed_" + to_string(seed) + "_" + str(sc) + "/";
+  mkdir(convert_string(file_storage_location), 0777);
+
+  search_config.search_type = SearchType::GREENFIELD;
+  search_config.grid_square = sc;
+  search_config.logger.set_cell(str(sc));
+  search_config.logger.set_stage("bench");
+
+  printf("Benchmark for %s with seed %lu\n", convert_string(str(sc)), (unsigned long)seed);
+  SyntheticTerrain terrain(seed, sc);
+  unsigned long t_usec = walltime_usec();
+  int written = write_synthetic_tiles(terrain, sc);
+  print_rate("terrain", (double)written * 3601 * 3601, "cells", 1.0e-6 * (walltime_usec() - t_usec));
+
+  GridSquare neighbors[9] = {
+      (GridSquare){sc.lat, sc.lon},         (GridSquare){sc.lat + 1, sc.lon - 1},
+      (GridSquare){sc.lat + 1, sc.lon},     (GridSquare){sc.lat + 1, sc.lon + 1},
+      (GridSquare){sc.lat, sc.lon + 1},     (GridSquare){sc.lat - 1, sc.lon + 1},
+      (GridSquare){sc.lat - 1, sc.lon},     (GridSquare){sc.lat - 1, sc.lon - 1},
+      (GridSquare){sc.lat, sc.lon - 1}};
+
+  metrics.reset();
+  allocations = 0;
+  t_usec = walltime_usec();
+  Model<char> *flow_directions[9];
+  vector<unique_ptr<RoughReservoir>> upper_reservoirs;
+  vector<unique_ptr<RoughReservoir>> lower_reservoirs;
+  for (int i = 0; i < 9; i++) {
+    ScreeningResult result = screen_grid_square(neighbors[i], params);
+    flow_directions[i] = result.flow_directions;
+    if (i == 0)
+      upper_reservoirs = round_trip_rough_reservoirs(result.reservoirs);
+    vector<unique_ptr<RoughReservoir>> lowers = round_trip_rough_reservoirs(result.reservoirs);
+    for (uint j = 0; j < lowers.size(); j++)
+      lower_reservoirs.push_back(std::move(lowers[j]));
+  }
+  double screening_seconds = 1.0e-6 * (walltime_usec() - t_usec);
+  double cells_per_square = SQ(3600.0 + 2 * params.border);
+  printf("\nScreening: %lu reservoirs in the centre square, %lu in all 9\n",
+         upper_reservoirs.size(), lower_reservoirs.size());
+  print_rate("total", 9 * cells_per_square, "cells", screening_seconds);
+  print_step_rates(cells_per_square);
+  print_rate("cells_flooded", metrics.counters[CELLS_FLOODED], "cells",
+             metrics.timers["model_reservoirs"].seconds);
+  print_rate("allocations", allocations, "allocs", screening_seconds);
+
+  metrics.reset();
+  allocations = 0;
+  t_usec = walltime_usec();
+  vector<Pair> found;
+  vector<int> counts;
+  pairing(upper_reservoirs, lower_reservoirs, [&](Pair &pair) { found.push_back(pair); }, counts,
+          true, params);
+  double pairing_seconds = 1.0e-6 * (walltime_usec() - t_usec);
+  printf("\nPairing: %lu pairs found\n", found.size());
+  print_rate("pairs_tested", metrics.counters[PAIRS_TESTED], "pairs", pairing_seconds);
+  print_rate("pairs_found", found.size(), "pairs", pairing_seconds);
+  print_rate("allocations", allocations, "allocs", pairing_seconds);
+
+  vector<vector<Pair>> pairs = round_trip_rough_pairs(found);
+  metrics.reset();
+  allocations = 0;
+  t_usec = walltime_usec();
+  BigModel big_model = BigModel_init(sc, flow_directions);
+  vector<Pair> selected = select_pretty_set(pairs, big_model, params);
+  double pretty_set_seconds = 1.0e-6 * (walltime_usec() - t_usec);
+  BigModel_free(big_model);
+  printf("\nPretty set: %lu pairs selected\n", selected.size());
+  print_rate("pairs_checked", found.size(), "pairs", pretty_set_seconds);
+  print_rate("cells_flooded", metrics.counters[CELLS_FLOODED], "cells",
+             metrics.timers["check_pair"].seconds);
+  print_rate("allocations", allocations, "allocs", pretty_set_seconds);
+  printf("  %-24s %12.1f\n", "allocations_per_pair",
+         found.size() > 0 ? (double)allocations / found.size() : 0.0);
+
+  search_config.logger.flush();
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include "phes_base.h"
+#include "stages.hpp"
+
+// Runs screening, pairing, pretty_set and constructor for a greenfield grid square in one process.
+// The grid square and its 8 neighbours are screened in memory, so only the final outputs are
+// written rather than the reservoirs, pairs and flow directions in processing_files.
+int main(int nargs, char **argv) {
+  search_config = SearchConfig(nargs, argv);
+
+  GDALAllRegister();
+  parse_variables(convert_string("storage_location"));
+  parse_variables(convert_string(file_storage_location + "variables"));
+  const SearchParameters params = SearchParameters::from_variables();
+
+  if (search_config.search_type != SearchType::GREENFIELD) {
+    search_config.logger.error("phes_cell only runs greenfield grid squares");
+    return 1;
+  }
+
+  cout << "Cell started for " << search_config.filename() << endl;
+  unsigned long t_usec = walltime_usec();
+  mkdir(convert_string(file_storage_location + "output"), 0777);
+
+  // In the same order as BigModel, which takes the flow directions
+  GridSquare sc = search_config.grid_square;
+  GridSquare neighbors[9] = {
+      (GridSquare){sc.lat, sc.lon},         (GridSquare){sc.lat + 1, sc.lon - 1},
+      (GridSquare){sc.lat + 1, sc.lon},     (GridSquare){sc.lat + 1, sc.lon + 1},
+      (GridSquare){sc.lat, sc.lon + 1},     (GridSquare){sc.lat - 1, sc.lon + 1},
+      (GridSquare){sc.lat - 1, sc.lon},     (GridSquare){sc.lat - 1, sc.lon - 1},
+      (GridSquare){sc.lat, sc.lon - 1}};
+
+  Model<char> *flow_directions[9];
+  vector<unique_ptr<RoughReservoir>> upper_reservoirs;
+  vector<unique_ptr<RoughReservoir>> lower_reservoirs;
+  search_config.logger.set_stage("screening");
+  metrics.reset();
+  for (int i = 0; i < 9; i++) {
+    flow_directions[i] = NULL;
+    try {
+      ScreeningResult result = screen_grid_square(neighbors[i], params);
+      flow_directions[i] = result.flow_directions;
+      if (i == 0)
+        upper_reservoirs = round_trip_rough_reservoirs(result.reservoirs);
+      vector<unique_ptr<RoughReservoir>> lowers = round_trip_rough_reservoirs(result.reservoirs);
+      for (uint j = 0; j < lowers.size(); j++)
+        lower_reservoirs.push_back(std::move(lowers[j]));
+    } catch (int e) {
+      if (i == 0)
+        throw;
+      search_config.logger.debug("Could not screen " + str(neighbors[i]));
+    }
+  }
+  search_config.logger.flush();
+  printf(convert_string("Screening finished for " + str(sc) + ". Runtime: %.2f sec\n"),
+         1.0e-6 * (walltime_usec() - t_usec));
+  search_config.logger.debug("Found ", upper_reservoirs.size(), " uppers");
+  search_config.logger.debug("Found ", lower_reservoirs.size(), " lowers");
+  write_metrics("screening");
+
+  search_config.logger.set_stage("pairing");
+  metrics.reset();
+  vector<Pair> found;
+  vector<int> counts;
+  pairing(upper_reservoirs, lower_reservoirs, [&](Pair &pair) { found.push_back(pair); }, counts,
+          true, params);
+  vector<vector<Pair>> pairs = round_trip_rough_pairs(found);
+  search_config.logger.flush();
+  printf(convert_string("Pairing finished for " + str(sc) + ". Found %d pairs. Runtime: %.2f sec\n"),
+         (int)found.size(), 1.0e-6 * (walltime_usec() - t_usec));
+  write_metrics("pairing");
+
+  if (found.empty()) {
+    search_config.logger.set_stage("constructor");
+    metrics.reset();
+    for (int i = 0; i < 9; i++)
+      delete flow_directions[i];
+    int result = construct_pairs(pairs, NULL, params);
+    write_metrics("constructor");
+    return result;
+  }
+
+  search_config.logger.set_stage("pretty_set");
+  metrics.reset();
+  BigModel big_model = BigModel_init(sc, flow_directions);
+  vector<Pair> selected = select_pretty_set(pairs, big_model, params);
+  pairs = round_trip_rough_pairs(selected);
+  search_config.logger.flush();
+  printf(convert_string("Pretty set finished for " + str(sc) + ". Runtime: %.2f sec\n"),
+         1.0e-6 * (walltime_usec() - t_usec));
+  write_metrics("pretty_set");
+
+  search_config.logger.set_stage("constructor");
+  metrics.reset();
+  int result = construct_pairs(pairs, &big_model, params);
+  BigModel_free(big_model);
+  write_metrics("constructor");
+  return result;
+}
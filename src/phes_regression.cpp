@@ -0,0 +1,204 @@
+#include "boost/filesystem.hpp"
+#include "csv_compare.hpp"
+#include "phes_base.h"
+#include "stages.hpp"
+#include "synthetic_dem.hpp"
+namespace fs = boost::filesystem;
+
+// Runs the pipeline for a DEM square on synthetic fixture tiles and compares the outputs of two
+// runs, so changes to the search can be checked against earlier results. Each run is kept in
+// <storage location>/regression/<name> and can use an overlay, a variables file read after the
+// usual one, to try a different configuration.
+//   ./bin/phes_regression <lon> <lat> [<overlay A> [<overlay B>]]   Runs A and B, then compares them
+//   ./bin/phes_regression run <name> <lon> <lat> [<overlay>]        Runs the pipeline into <name>
+//   ./bin/phes_regression compare <name A> <name B> <lon> <lat>     Compares two earlier runs
+// A name for compare can also be a path to a storage location, such as a normal search.
+// --tolerance <t> sets the tolerance on numbers (default 1e-6) and --strict-order also requires
+// the rows to be in the same order.
+// The fixtures are full 3601 by 3601 tiles, as the stages read DEMs laid out as SRTM tiles.
+// --single-square writes and screens only the tile of the DEM square, without its neighbours, so
+// a run takes a fraction of the time and memory. Its pairs are then only those within the square.
+
+const uint64_t fixture_seed = 1;
+
+static GridSquare neighbors_of(GridSquare sc, int i) {
+  GridSquare neighbors[9] = {
+      (GridSquare){sc.lat, sc.lon},         (GridSquare){sc.lat + 1, sc.lon - 1},
+      (GridSquare){sc.lat + 1, sc.lon},     (GridSquare){sc.lat + 1, sc.lon + 1},
+      (GridSquare){sc.lat, sc.lon + 1},     (GridSquare){sc.lat - 1, sc.lon + 1},
+      (GridSquare){sc.lat - 1, sc.lon},     (GridSquare){sc.lat - 1, sc.lon - 1},
+      (GridSquare){sc.lat, sc.lon - 1}};
+  return neighbors[i];
+}
+
+static string task(GridSquare gs) {
+  return to_string(gs.lon) + " " + to_string(gs.lat);
+}
+
+// Writes the fixture tiles and countries for a DEM square once, shared by all the runs for it. The
+// terrain is laid out around the square, so each square has its own fixtures.
+static string write_fixtures(string regression_folder, GridSquare sc, bool single_square) {
+  string storage_location = file_storage_location;
+  mkdir(convert_string(regression_folder + "fixtures"), 0777);
+  string fixtures_folder = regression_folder + "fixtures/" + str(sc) + "/";
+  file_storage_location = fixtures_folder;
+  mkdir(convert_string(file_storage_location), 0777);
+  SyntheticTerrain terrain(fixture_seed, sc);
+  write_synthetic_tiles(terrain, sc, !single_square);
+
+  mkdir(convert_string(file_storage_location + "input/countries"), 0777);
+  string countries = file_storage_location + "input/countries/countries.txt";
+  if (!file_exists(countries)) {
+    if (file_exists(storage_location + "input/countries/countries.txt"))
+      fs::copy_file(storage_location + "input/countries/countries.txt", countries);
+    else
+      ofstream(countries).close();
+  }
+  file_storage_location = storage_location;
+  return fixtures_folder;
+}
+
+static int run_pipeline(string name, GridSquare sc, string overlay, bool single_square) {
+  parse_variables(convert_string("storage_location"));
+  parse_variables(convert_string(file_storage_location + "variables"));
+  if (!overlay.empty())
+    parse_variables(convert_string(overlay));
+  // The filters are for real locations
+  filter_filenames.clear();
+
+  string regression_folder = file_storage_location + "regression/";
+  mkdir(convert_string(regression_folder), 0777);
+  write_fixtures(regression_folder, sc, single_square);
+
+  string folder = regression_folder + name + "/";
+  fs::remove_all(folder + "output");
+  fs::remove_all(folder + "processing_files");
+  mkdir(convert_string(folder), 0777);
+  fs::remove(folder + "input");
+  fs::create_symlink("../fixtures/" + str(sc) + "/input", folder + "input");
+  file_storage_location = folder;
+
+  for (int i = 0; i < (single_square ? 1 : 9); i++) {
+    search_config = SearchConfig(task(neighbors_of(sc, i)));
+    run_screening();
+  }
+  search_config = SearchConfig(task(sc));
+  run_pairing();
+  run_pretty_set();
+  run_constructor();
+  return 0;
+}
+
+// A name is a run in the regression folder, anything with a '/' is a storage location
+static string run_folder(string name) {
+  if (name.find('/') != string::npos)
+    return name.back() == '/' ? name : name + "/";
+  return file_storage_location + "regression/" + name + "/";
+}
+
+static int compare_runs(string name_a, string name_b, GridSquare sc, bool single_square,
+                        double tolerance, bool strict_order) {
+  parse_variables(convert_string("storage_location"));
+  string folder_a = run_folder(name_a);
+  string folder_b = run_folder(name_b);
+  string cell = str(sc);
+
+  vector<string> filenames;
+  for (int i = 0; i < (single_square ? 1 : 9); i++)
+    filenames.push_back("processing_files/reservoirs/" + str(neighbors_of(sc, i)) +
+                        "_reservoirs_data.csv");
+  filenames.push_back("processing_files/pairs/" + cell + "_rough_pairs_data.csv");
+  set<string> final_outputs;
+  for (string folder : {folder_a, folder_b}) {
+    fs::path p(folder + "output/final_output_FOM/" + cell);
+    if (!fs::is_directory(p))
+      continue;
+    for (fs::directory_iterator it(p); it != fs::directory_iterator(); it++)
+      if (it->path().extension() == ".csv")
+        final_outputs.insert("output/final_output_FOM/" + cell + "/" +
+                             it->path().filename().string());
+  }
+  if (final_outputs.empty())
+    final_outputs.insert("output/final_output_FOM/" + cell + "/" + cell + "_total.csv");
+  filenames.insert(filenames.end(), final_outputs.begin(), final_outputs.end());
+
+  printf("Comparing A: %s with B: %s\n", convert_string(folder_a), convert_string(folder_b));
+  int differences = 0;
+  for (string filename : filenames) {
+    CsvComparison comparison = compare_csv_files(folder_a + filename, folder_b + filename, tolerance);
+    comparison.filename = filename;
+    print_csv_comparison(comparison, strict_order);
+    if (!comparison.same(strict_order))
+      differences++;
+  }
+  if (differences > 0)
+    printf("%d of %lu files differ\n", differences, filenames.size());
+  else
+    printf("All %lu files are the same\n", filenames.size());
+  return differences > 0;
+}
+
+static string run_name(string overlay) {
+  if (overlay.empty())
+    return "baseline";
+  return fs::path(overlay).stem().string();
+}
+
+int main(int nargs, char **argv) {
+  double tolerance = 1e-6;
+  bool strict_order = false;
+  bool single_square = false;
+  vector<string> args;
+  for (int i = 1; i < nargs; i++) {
+    string arg(argv[i]);
+    if (arg == "--tolerance" && i + 1 < nargs)
+      tolerance = stod(argv[++i]);
+    else if (arg == "--strict-order")
+      strict_order = true;
+    else if (arg == "--single-square")
+      single_square = true;
+    else
+      args.push_back(arg);
+  }
+
+  GDALAllRegister();
+  search_config.logger.set_stage("regression");
+  try {
+    if (args.size() >= 4 && args[0] == "run")
+      return run_pipeline(args[1], GridSquare_init(stoi(args[3]), stoi(args[2])),
+                          args.size() > 4 ? args[4] : "", single_square);
+    if (args.size() >= 5 && args[0] == "compare")
+      return compare_runs(args[1], args[2], GridSquare_init(stoi(args[4]), stoi(args[3])),
+                          single_square, tolerance, strict_order);
+    if (args.size() >= 2 && args[0] != "run" && args[0] != "compare") {
+      GridSquare sc = GridSquare_init(stoi(args[1]), stoi(args[0]));
+      string overlay_a = args.size() > 2 ? args[2] : "";
+      string overlay_b = args.size() > 3 ? args[3] : "";
+      string name_a = run_name(overlay_a);
+      string name_b = run_name(overlay_b);
+      if (name_a == name_b) {
+        name_a += "_A";
+        name_b += "_B";
+      }
+      // Each run is a separate process, as the variables are globals
+      for (auto [name, overlay] : {pair(name_a, overlay_a), pair(name_b, overlay_b)}) {
+        string command = string(argv[0]) + " run " + name + " " + task(sc) + " " + overlay;
+        if (single_square)
+          command += " --single-square";
+        if (system(convert_string(command))) {
+          search_config.logger.error("Problem running " + command);
+          return 1;
+        }
+      }
+      return compare_runs(name_a, name_b, sc, single_square, tolerance, strict_order);
+    }
+  } catch (int e) {
+    search_config.logger.error("Error ", e);
+    return 1;
+  }
+  printf("Usage: phes_regression <lon> <lat> [<overlay A> [<overlay B>]]\n"
+         "       phes_regression run <name> <lon> <lat> [<overlay>]\n"
+         "       phes_regression compare <name A> <name B> <lon> <lat>\n"
+         "Options: --tolerance <t> --strict-order --single-square\n");
+  return 1;
+}
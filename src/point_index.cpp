@@ -0,0 +1,120 @@
+#include "point_index.hpp"
+
+static const int leaf_size = 8;
+
+// The bounds are found from geographic coordinates, which can round differently from the
+// distances measured, so a node is only skipped when its bound is clearly past the best distance
+static bool beyond(double bound, double best_distance) {
+  return bound * (1 - 1e-6) - 1e-9 > best_distance;
+}
+
+// The distance from x to the nearest value in [min, max]
+static double gap(double x, double min, double max) {
+  if (x < min)
+    return min - x;
+  if (x > max)
+    return x - max;
+  return 0;
+}
+
+PointIndex::PointIndex(const vector<ArrayCoordinate> &points) : points(points) {
+  geographic.reserve(points.size());
+  order.reserve(points.size());
+  for (uint i = 0; i < points.size(); i++) {
+    geographic.push_back(convert_coordinates(points[i]));
+    order.push_back(i);
+  }
+  if (!points.empty())
+    build(0, points.size());
+}
+
+int PointIndex::build(int begin, int end) {
+  Node node = {begin, end, -1, -1, INF, -INF, INF, -INF};
+  for (int k = begin; k < end; k++) {
+    GeographicCoordinate g = geographic[order[k]];
+    node.min_lat = MIN(node.min_lat, g.lat);
+    node.max_lat = MAX(node.max_lat, g.lat);
+    node.min_lon = MIN(node.min_lon, g.lon);
+    node.max_lon = MAX(node.max_lon, g.lon);
+  }
+  int n = nodes.size();
+  nodes.push_back(node);
+  if (end - begin <= leaf_size)
+    return n;
+
+  // Split at the median along the longer side
+  bool by_lat = node.max_lat - node.min_lat > node.max_lon - node.min_lon;
+  int middle = (begin + end) / 2;
+  nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+              [&](int a, int b) {
+                return by_lat ? geographic[a].lat < geographic[b].lat
+                              : geographic[a].lon < geographic[b].lon;
+              });
+  int left = build(begin, middle);
+  int right = build(middle, end);
+  nodes[n].left = left;
+  nodes[n].right = right;
+  return n;
+}
+
+template <class Distance, class Bound>
+void PointIndex::search(int n, Distance &distance, Bound &bound, int &best,
+                        double &best_distance) {
+  const Node &node = nodes[n];
+  if (node.left < 0) {
+    for (int k = node.begin; k < node.end; k++) {
+      int i = order[k];
+      double d = distance(i);
+      if (d < best_distance || (best >= 0 && d == best_distance && i < best)) {
+        best = i;
+        best_distance = d;
+      }
+    }
+    return;
+  }
+
+  int near = node.left, far = node.right;
+  double near_bound = bound(nodes[near]), far_bound = bound(nodes[far]);
+  if (far_bound < near_bound) {
+    swap(near, far);
+    swap(near_bound, far_bound);
+  }
+  if (!beyond(near_bound, best_distance))
+    search(near, distance, bound, best, best_distance);
+  if (!beyond(far_bound, best_distance))
+    search(far, distance, bound, best, best_distance);
+}
+
+int PointIndex::closest(ArrayCoordinate p, double &distance) {
+  if (nodes.empty())
+    return -1;
+  GeographicCoordinate g = convert_coordinates(p);
+  auto point_distance = [&](int i) { return find_distance(geographic[i], g); };
+  // find_distance takes the cosine at the middle latitude, which is smallest at one of the
+  // ends of the node's range
+  auto node_bound = [&](const Node &node) {
+    double coslat = MIN(COS(RADIANS(0.5 * (g.lat + node.min_lat))),
+                        COS(RADIANS(0.5 * (g.lat + node.max_lat))));
+    return SQRT((SQ(gap(g.lat, node.min_lat, node.max_lat)) +
+                 SQ(gap(g.lon, node.min_lon, node.max_lon) * coslat)) *
+                SQ(3600 * resolution * 0.001));
+  };
+  int best = -1;
+  search(0, point_distance, node_bound, best, distance);
+  return best;
+}
+
+int PointIndex::closest_sqd(ArrayCoordinate p, double coslat, double &distance_sqd) {
+  if (nodes.empty())
+    return -1;
+  GeographicCoordinate g = convert_coordinates(p);
+  auto point_distance = [&](int i) { return find_distance_sqd(points[i], p, coslat); };
+  auto node_bound = [&](const Node &node) {
+    return (SQ(gap(g.lat, node.min_lat, node.max_lat)) +
+            SQ(gap(g.lon, node.min_lon, node.max_lon) * coslat)) *
+           SQ(3600 * resolution * 0.001);
+  };
+  int best = -1;
+  search(0, point_distance, node_bound, best, distance_sqd);
+  return best;
+}
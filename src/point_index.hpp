@@ -0,0 +1,37 @@
+#ifndef POINT_INDEX_H
+#define POINT_INDEX_H
+
+#include "phes_base.h"
+
+// A k-d tree over a set of points, such as the outline of an existing reservoir, for finding the
+// closest of them to other points without measuring the distance to every point. Distances are
+// those of find_distance and find_distance_sqd, and of equally close points the first in the set
+// is found, so the results are the same as a loop over the set.
+class PointIndex {
+public:
+  PointIndex(const vector<ArrayCoordinate> &points);
+
+  // The index of the point closest to p by find_distance, if it is closer than distance, which is
+  // then set to its distance. Otherwise -1.
+  int closest(ArrayCoordinate p, double &distance);
+  // As closest, by find_distance_sqd with coslat
+  int closest_sqd(ArrayCoordinate p, double coslat, double &distance_sqd);
+
+private:
+  struct Node {
+    int begin, end;  // The points in order[begin, end)
+    int left, right; // -1 for a leaf
+    double min_lat, max_lat, min_lon, max_lon;
+  };
+
+  int build(int begin, int end);
+  template <class Distance, class Bound>
+  void search(int node, Distance &distance, Bound &bound, int &best, double &best_distance);
+
+  vector<ArrayCoordinate> points;
+  vector<GeographicCoordinate> geographic;
+  vector<int> order;
+  vector<Node> nodes;
+};
+
+#endif
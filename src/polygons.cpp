@@ -1,5 +1,7 @@
 #include "polygons.h"
 #include "model2D.h"
+#include "constructor_helpers.hpp"
+#include "occupancy.hpp"
 
 // find_polygon_intersections returns an array containing the longitude of all line. Assumes last coordinate is same as first
 vector<double> find_polygon_intersections(int row, vector<GeographicCoordinate> &polygon, Model<bool>* filter){
@@ -27,6 +29,17 @@ void polygon_to_raster(vector<GeographicCoordinate> &polygon, Model<bool>* raste
     }
 }
 
+void polygon_to_raster(vector<GeographicCoordinate> &polygon, Occupancy* raster){
+    for(int row =0; row<raster->nrows(); row++){
+        vector<double> polygon_intersections = find_polygon_intersections(raster->get_coordinate(row, 0).lat, polygon);
+        for(uint j = 0; j<polygon_intersections.size()/2;j++){
+            int start = convert_coordinates(GeographicCoordinate_init(0, polygon_intersections[2*j]),raster->get_origin()).col;
+            int end = convert_coordinates(GeographicCoordinate_init(0, polygon_intersections[2*j+1]),raster->get_origin()).col;
+            raster->add((Run){row, MAX(start, 0), MIN(end, raster->ncols())});
+        }
+    }
+}
+
 void read_shp_filter(string filename, Model<bool>* filter){
 	char *shp_filename = new char[filename.length() + 1];
 	strcpy(shp_filename, filename.c_str());
@@ -1,53 +1,151 @@
 #include "phes_base.h"
 #include "search_config.hpp"
 #include "constructor_helpers.hpp"
-
-bool check_pair(Pair &pair, Model<bool> *seen, BigModel &big_model, set<string>& used_with_river) {
-  vector<vector<vector<GeographicCoordinate>>> empty_countries;
-  vector<string> empty_country_names;
-  vector<ArrayCoordinate> used_points;
-  if(pair.lower.river && used_with_river.contains(pair.upper.identifier))
+#include "stages.hpp"
+
+// Each upper reservoir can only be used with one river. used holds the upper reservoirs that have
+// been, and tried the uppers of the river pairs that got past that check, which are the river
+// pairs whose result would change if the upper had been used by an earlier test.
+struct RiverLedger {
+  set<string> used;
+  set<string> tried;
+};
+
+bool check_pair(Pair &pair, Occupancy *seen, BigModel &big_model, RiverLedger &rivers,
+                const SearchParameters &params) {
+  ScopedTimer timer("check_pair");
+  Footprint footprint;
+  if(pair.lower.river && rivers.used.contains(pair.upper.identifier))
     return false;
-  if(pair.lower.river && !use_tiled_rivers)
+  if(pair.lower.river && !params.use_tiled_rivers)
     return false;
+  if(pair.lower.river)
+    rivers.tried.insert(pair.upper.identifier);
   if (!pair.upper.brownfield &&
-      !model_reservoir(&pair.upper, NULL, seen, NULL, &used_points, big_model, NULL,
-                       empty_countries, empty_country_names))
+      !model_reservoir(&pair.upper, NULL, seen, NULL, &footprint, big_model, NULL,
+                       params))
     return false;
   if (!pair.lower.brownfield && !pair.lower.ocean &&
-      !model_reservoir(&pair.lower, NULL, seen, NULL, &used_points, big_model, NULL,
-                       empty_countries, empty_country_names))
+      !model_reservoir(&pair.lower, NULL, seen, NULL, &footprint, big_model, NULL,
+                       params))
     return false;
 
   if (pair.upper.brownfield && pair.upper.volume > INF/10 && !pair.lower.brownfield) {
-    if (pair.lower.area > max_bluefield_surface_area_ratio * pair.upper.area)
+    if (pair.lower.area > params.max_bluefield_surface_area_ratio * pair.upper.area)
       return false;
   }
   if (pair.lower.brownfield && pair.lower.volume > INF/10 && !pair.upper.brownfield) {
-    if (pair.upper.area > max_bluefield_surface_area_ratio * pair.lower.area)
+    if (pair.upper.area > params.max_bluefield_surface_area_ratio * pair.lower.area)
       return false;
   }
 
-  for (uint i = 0; i < used_points.size(); i++) {
-    seen->set(used_points[i].row, used_points[i].col, true);
-  }
+  seen->add(footprint);
   if(pair.lower.river)
-    used_with_river.insert(pair.upper.identifier);
+    rivers.used.insert(pair.upper.identifier);
 
   return true;
 }
 
-int main(int nargs, char **argv)
+// Selects the pairs of test i in FOM order that don't overlap the pairs already selected for it
+static vector<Pair> select_test_pairs(vector<Pair> &pairs, uint i, Occupancy *seen,
+                                      BigModel &big_model, RiverLedger &rivers,
+                                      const SearchParameters &params) {
+  vector<Pair> selected;
+  sort(pairs.begin(), pairs.end());
+  seen->clear();
+
+  if (search_config.search_type.single()) {
+    ExistingReservoir r = get_existing_reservoir(search_config.name);
+    polygon_to_raster(r.polygon, seen);
+  }
+
+  for (uint j = 0; j < pairs.size(); j++)
+    if (check_pair(pairs[j], seen, big_model, rivers, params))
+      selected.push_back(pairs[j]);
+  search_config.logger.debug(to_string(selected.size()) + " " + to_string(params.tests[i].energy_capacity) + "GWh "+to_string(params.tests[i].storage_time) + "h Pairs");
+  return selected;
+}
+
+// The result of running a test on its own, with a copy of its pairs
+struct TestSelection {
+  vector<Pair> pairs;
+  vector<Pair> selected;
+  RiverLedger rivers;
+};
+
+vector<Pair> select_pretty_set(vector<vector<Pair>> &pairs, BigModel &big_model,
+                               const SearchParameters &params) {
+  ScopedTimer timer("select_pretty_set");
+  vector<Pair> selected;
+  RiverLedger rivers;
+  Occupancy *seen = new Occupancy(big_model.DEM->nrows(), big_model.DEM->ncols());
+  seen->set_geodata(big_model.DEM->get_geodata());
+  uint nthreads = MIN(MAX(stage_threads, 1), (int)params.tests.size());
+
+  // The tests are run concurrently, each starting with no rivers used. A test then selects the
+  // same pairs as when run in turn unless it tried a river with an upper reservoir that an earlier
+  // test used with a river, in which case it is run again in turn.
+  vector<TestSelection> tests(nthreads > 1 ? params.tests.size() : 0);
+  if (nthreads > 1) {
+    atomic<uint> next_test(0);
+    SearchConfig config = search_config;
+    vector<Metrics> thread_metrics(nthreads);
+    vector<exception_ptr> errors(nthreads);
+    vector<thread> threads;
+    for (uint t = 0; t < nthreads; t++)
+      threads.push_back(thread([&, t]() {
+        search_config = config;
+        try {
+          Occupancy thread_seen(seen->nrows(), seen->ncols());
+          thread_seen.set_geodata(seen->get_geodata());
+          for (uint i = next_test++; i < tests.size(); i = next_test++) {
+            tests[i].pairs = pairs[i];
+            tests[i].selected = select_test_pairs(tests[i].pairs, i, &thread_seen, big_model,
+                                                  tests[i].rivers, params);
+          }
+        } catch (...) {
+          errors[t] = current_exception();
+        }
+        thread_metrics[t] = metrics;
+      }));
+    for (uint t = 0; t < nthreads; t++) {
+      threads[t].join();
+      metrics.add(thread_metrics[t]);
+    }
+    for (uint t = 0; t < nthreads; t++)
+      if (errors[t]) {
+        delete seen;
+        rethrow_exception(errors[t]);
+      }
+  }
+
+  for (uint i = 0; i < params.tests.size(); i++) {
+    bool in_turn = nthreads <= 1;
+    if (!in_turn)
+      for (string upper : tests[i].rivers.tried)
+        in_turn = in_turn || rivers.used.contains(upper);
+    if (in_turn) {
+      vector<Pair> test_selected = select_test_pairs(pairs[i], i, seen, big_model, rivers, params);
+      selected.insert(selected.end(), test_selected.begin(), test_selected.end());
+    } else {
+      pairs[i] = move(tests[i].pairs);
+      selected.insert(selected.end(), tests[i].selected.begin(), tests[i].selected.end());
+      rivers.used.insert(tests[i].rivers.used.begin(), tests[i].rivers.used.end());
+    }
+  }
+  delete seen;
+  return selected;
+}
+
+int run_pretty_set()
 {
-  search_config = SearchConfig(nargs, argv);
+  search_config.logger.set_stage("pretty_set");
+  metrics.reset();
   vector<vector<Pair>> pairs;
-  set<string> used_with_river;
 
 	cout << "Pretty set started for " << search_config.filename() << endl;
+	const SearchParameters params = SearchParameters::from_variables();
 
-	GDALAllRegister();
-	parse_variables(convert_string("storage_location"));
-	parse_variables(convert_string(file_storage_location+"variables"));
 	unsigned long t_usec = walltime_usec();
 
 	pairs = read_rough_pair_data(convert_string(file_storage_location+"processing_files/pairs/"+search_config.filename()+"_rough_pairs_data.csv"));
@@ -62,7 +160,11 @@ int main(int nargs, char **argv)
 
 	if (total_pairs == 0) {
 		cout << "No pairs found" << endl;
+		count_file_written(csv_data_file);
+		fclose(csv_data_file);
+		search_config.logger.flush();
 		cout << "Pretty set finished for " << search_config.filename() << ". Runtime: " << 1.0e-6*(walltime_usec() - t_usec)<< " sec" << endl;
+		write_metrics("pretty_set");
 		return 0;
 	}
 
@@ -70,26 +172,16 @@ int main(int nargs, char **argv)
 		search_config.grid_square = get_square_coordinate(get_existing_reservoir(search_config.name));
 
 	BigModel big_model = BigModel_init(search_config.grid_square);
-
-	for(uint i = 0; i<tests.size(); i++){
-		sort(pairs[i].begin(), pairs[i].end());
-		Model<bool>* seen = new Model<bool>(big_model.DEM->nrows(), big_model.DEM->nrows(), MODEL_SET_ZERO);
-		seen->set_geodata(big_model.DEM->get_geodata());
-
-		if(search_config.search_type.single()){
-			ExistingReservoir r = get_existing_reservoir(search_config.name);
-			polygon_to_raster(r.polygon, seen);
-		}
-
-		int count = 0;
-		for(uint j=0; j<pairs[i].size(); j++){
-			if(check_pair(pairs[i][j], seen, big_model, used_with_river)){
-				write_rough_pair_data(csv_data_file, &pairs[i][j]);
-				count++;
-			}
-		}
-		delete seen;
-		search_config.logger.debug(to_string(count) + " " + to_string(tests[i].energy_capacity) + "GWh "+to_string(tests[i].storage_time) + "h Pairs");
-	}
+	vector<Pair> selected = select_pretty_set(pairs, big_model, params);
+	CSVWriter csv_data(csv_data_file);
+	for(uint i = 0; i<selected.size(); i++)
+		write_rough_pair_data(csv_data, &selected[i]);
+	csv_data.flush();
+	count_file_written(csv_data_file);
+	fclose(csv_data_file);
+	BigModel_free(big_model);
+	search_config.logger.flush();
 	cout << "Pretty set finished for " << search_config.filename() << ". Runtime: " << 1.0e-6*(walltime_usec() - t_usec)<< " sec" << endl;
+	write_metrics("pretty_set");
+	return 0;
 }
@@ -4,8 +4,8 @@ using namespace std;
 #include "phes_base.h"
 
 void update_reservoir_boundary(
-    vector<array<ArrayCoordinate, directions.size()>> &dam_shape_bounds,
-    ArrayCoordinate point, int elevation_above_pp) {
+    vector<array<GridPoint, directions.size()>> &dam_shape_bounds,
+    GridPoint point, int elevation_above_pp, const vector<double> &dam_wall_heights) {
   for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
     int dam_height = dam_wall_heights[ih];
     if (dam_height >= elevation_above_pp)
@@ -21,7 +21,7 @@ void update_reservoir_boundary(
 
 void update_reservoir_boundary(
     vector<ArrayCoordinate> &dam_shape_bounds,
-    ArrayCoordinate point) {
+    GridPoint point) {
   for (uint i = 0; i < directions.size(); i++) {
     if ((directions[i].row * point.row + directions[i].col * point.col) >
         (directions[i].row * dam_shape_bounds[i].row +
@@ -41,18 +41,19 @@ class RoughReservoir{
   private:
 };
 
+// The shape bounds of rough reservoirs are in the grid of the pour point
 class RoughGreenfieldReservoir : public RoughReservoir {
 public:
-  vector<array<ArrayCoordinate, directions.size()>> shape_bound;
+  vector<array<GridPoint, directions.size()>> shape_bound;
 
   explicit RoughGreenfieldReservoir(const RoughReservoir& r)
+      : RoughGreenfieldReservoir(r, ::dam_wall_heights) {}
+
+  RoughGreenfieldReservoir(const RoughReservoir& r, const vector<double> &dam_wall_heights)
       : RoughReservoir(r) {
     for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
-      array<ArrayCoordinate, directions.size()> temp_array;
-      for (uint idir = 0; idir < directions.size(); idir++) {
-        temp_array[idir].row = pour_point.row;
-        temp_array[idir].col = pour_point.col;
-      }
+      array<GridPoint, directions.size()> temp_array;
+      temp_array.fill({pour_point.row, pour_point.col});
       this->shape_bound.push_back(temp_array);
     }
   }
@@ -60,7 +61,7 @@ public:
 
 class RoughBfieldReservoir : public RoughReservoir {
 public:
-  vector<ArrayCoordinate> shape_bound;
+  vector<GridPoint> shape_bound;
   vector<int> elevations;
   RoughBfieldReservoir() {};
   explicit RoughBfieldReservoir(const RoughReservoir &r) : RoughReservoir(r) {}
@@ -136,10 +137,11 @@ struct Pair {
   bool operator<(const Pair &o) const { return FOM < o.FOM; }
 };
 
-void update_reservoir_boundary(vector<array<ArrayCoordinate, directions.size()>> &dam_shape_bounds,
-                               ArrayCoordinate point, int elevation_above_pp);
+void update_reservoir_boundary(vector<array<GridPoint, directions.size()>> &dam_shape_bounds,
+                               GridPoint point, int elevation_above_pp,
+                               const vector<double> &dam_wall_heights);
 void update_reservoir_boundary(vector<ArrayCoordinate> &dam_shape_bounds,
-                               ArrayCoordinate point);
+                               GridPoint point);
 Reservoir Reservoir_init(ArrayCoordinate pour_point, int elevation);
 ExistingReservoir ExistingReservoir_init(string identifier, double latitude, double longitude,
                                          int elevation, double volume);
@@ -0,0 +1,31 @@
+#include "reservoir_cache.hpp"
+
+static string flood_key(const string &identifier, GridPoint pour_point) {
+  return identifier + " " + to_string(pour_point.row) + " " + to_string(pour_point.col);
+}
+
+shared_ptr<const ReservoirFlood> ReservoirCache::find(const string &identifier,
+                                                      GridPoint pour_point, double dam_height) {
+  lock_guard<mutex> guard(lock);
+  auto it = floods.find(flood_key(identifier, pour_point));
+  if (it == floods.end() || it->second->top_height < dam_height)
+    return NULL;
+  metrics.count(FLOOD_CACHE_HITS);
+  return it->second;
+}
+
+void ReservoirCache::insert(const string &identifier, GridPoint pour_point,
+                            shared_ptr<const ReservoirFlood> flood) {
+  lock_guard<mutex> guard(lock);
+  shared_ptr<const ReservoirFlood> &cached = floods[flood_key(identifier, pour_point)];
+  size_t replaced = cached ? cached->cells.size() : 0;
+  if (cached && cached->top_height >= flood->top_height)
+    return;
+  if (cells - replaced + flood->cells.size() > max_cells) {
+    if (!cached)
+      floods.erase(flood_key(identifier, pour_point));
+    return;
+  }
+  cells += flood->cells.size() - replaced;
+  cached = flood;
+}
@@ -0,0 +1,63 @@
+#ifndef RESERVOIR_CACHE_H
+#define RESERVOIR_CACHE_H
+
+#include "occupancy.hpp"
+#include "phes_base.h"
+
+// A cell of a reservoir flood from its pour point. The cell is flooded at a dam height h when it
+// and every cell between it and the pour point are below h, that is when path_max < h.
+struct FloodCell {
+  GridPoint point;
+  int elevation; // Above the pour point
+  int path_max;
+  bool void_cell = false; // No data in the DEM
+  double big_area = 0; // The area used for the volume, in the grid of the big model
+  double area = 0;
+};
+
+// Totals over the flood cells with path_max up to a level
+struct FloodLevel {
+  double big_area;
+  double elevation_area;
+  double abs_elevation_area;
+};
+
+// A run of flood cells, where the cell at column c is cells[order[first + c - run.start]]
+struct FloodRun {
+  Run run;
+  uint first;
+};
+
+// The cells reached by a flood from the pour point up to top_height, in the order they are
+// reached. A flood up to a lower dam height reaches its cells in the same order, so one flood
+// gives the reservoir at every dam height up to top_height. Whether a cell has been used by
+// another reservoir changes as reservoirs are added, so that is left to the caller.
+struct ReservoirFlood {
+  double top_height;
+  int lowest_level; // The lowest path_max, other than the pour point's
+  int first_void;   // The lowest path_max of a void cell
+  vector<FloodCell> cells;
+  vector<FloodLevel> levels; // Running totals from lowest_level up
+  vector<uint> order;        // The indices of the cells sorted by row then column
+  vector<FloodRun> runs;     // The cells as runs along the rows, for overlaps with an Occupancy
+};
+
+// The floods of the reservoirs modelled for a grid square, so a reservoir that appears in many
+// pairs and tests is only flooded again when a higher dam height is needed. Only the highest
+// flood of each reservoir is kept, and floods are no longer added once max_cells are held.
+class ReservoirCache {
+public:
+  // A flood of the reservoir up to at least dam_height, or NULL if there isn't one
+  shared_ptr<const ReservoirFlood> find(const string &identifier, GridPoint pour_point,
+                                        double dam_height);
+  void insert(const string &identifier, GridPoint pour_point,
+              shared_ptr<const ReservoirFlood> flood);
+
+private:
+  static const size_t max_cells = 1 << 22;
+  mutex lock;
+  unordered_map<string, shared_ptr<const ReservoirFlood>> floods;
+  size_t cells = 0;
+};
+
+#endif
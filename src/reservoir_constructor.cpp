@@ -1,4 +1,5 @@
 #include "constructor_helpers.hpp"
+#include "country_index.hpp"
 #include "kml.h"
 #include "phes_base.h"
 #include <gdal/gdal.h>
@@ -28,11 +29,9 @@ int main(int nargs, char **argv) {
   unsigned long t_usec = walltime_usec();
   parse_variables(convert_string("storage_location"));
   parse_variables(convert_string(file_storage_location + "variables"));
+  const SearchParameters params = SearchParameters::from_variables();
 
   BigModel big_model = BigModel_init(square_coordinate);
-  Model<char> *full_cur_model = new Model<char>(
-      big_model.DEM->nrows(), big_model.DEM->ncols(), MODEL_SET_ZERO);
-  full_cur_model->set_geodata(big_model.DEM->get_geodata());
 
   vector<unique_ptr<RoughReservoir>> reservoirs = read_rough_reservoir_data(
       convert_string(file_storage_location + "processing_files/reservoirs/" +
@@ -40,9 +39,8 @@ int main(int nargs, char **argv) {
   search_config.logger.debug("Read in " + to_string(reservoirs.size()) +
                              " reservoirs");
 
-  vector<string> country_names;
-  vector<vector<vector<GeographicCoordinate>>> countries = read_countries(
-      file_storage_location + "input/countries/countries.txt", country_names);
+  shared_ptr<const CountryIndex> countries =
+      CountryIndex::load(file_storage_location + "input/countries/countries.txt");
 
   string rs(argv[3]);
   for (uint i = 0; i < reservoirs.size(); i++) {
@@ -62,7 +60,7 @@ int main(int nargs, char **argv) {
       Reservoir_KML_Coordinates *coordinates = new Reservoir_KML_Coordinates();
 
       model_reservoir(reservoir, coordinates, NULL, NULL, NULL, big_model,
-                      full_cur_model, countries, country_names);
+                      countries.get(), params);
 
       kml_file << output_kml(reservoir, *coordinates);
       delete reservoir;
@@ -0,0 +1,160 @@
+#include "scheduler.hpp"
+#include "driver_journal.hpp"
+#include "stages.hpp"
+
+void write_to_logfile(int id, string process, string message){
+	ofstream logfile;
+  	logfile.open(file_storage_location+"debug1/"+process+"_logfiles/"+process+"_"+to_string(id), ios_base::app);
+  	logfile<<message;
+  	logfile.close();
+}
+
+StageFunction find_stage(string process) {
+  if (process == "screening")
+    return run_screening;
+  if (process == "pairing")
+    return run_pairing;
+  if (process == "pretty_set")
+    return run_pretty_set;
+  if (process == "constructor")
+    return run_constructor;
+  return NULL;
+}
+
+bool run_driver_task(DriverTask &driver_task, int worker_id) {
+  StageFunction stage = find_stage(driver_task.process);
+  string command = driver_task.process + " " + driver_task.task;
+  for (int i = 0; i < 5; i++) {
+    if (stage == NULL) {
+      if (!system(convert_string("./bin/" + command)))
+        return true;
+    } else {
+      try {
+        search_config = SearchConfig(driver_task.task);
+        if (!stage())
+          return true;
+      } catch (int e) {
+        search_config.logger.error("Error " + to_string(e) + " running " + command);
+      } catch (exception &e) {
+        search_config.logger.error(string(e.what()) + " running " + command);
+      }
+    }
+    cout << "Retrying " + command + "\n";
+    write_to_logfile(worker_id, driver_task.process, "Retrying " + command + "\n");
+  }
+  cout << "Problem running " + command + "\n";
+  write_to_logfile(worker_id, driver_task.process, "Problem running " + command + "\n");
+  return false;
+}
+
+bool run_journaled_task(DriverTask &driver_task, int worker_id) {
+  write_journal_entry("claimed", driver_task.process, driver_task.task, worker_id);
+  write_journal_entry("running", driver_task.process, driver_task.task, worker_id);
+  unsigned long t_usec = walltime_usec();
+  bool success = run_driver_task(driver_task, worker_id);
+  write_journal_entry(success ? "succeeded" : "failed", driver_task.process, driver_task.task,
+                      worker_id, 1.0e-6 * (walltime_usec() - t_usec),
+                      find_task_outputs(driver_task.process, driver_task.task));
+  return success;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(vector<DriverTask> &graph, int nthreads,
+                                             TaskCostModel *cost_model)
+    : graph(graph), nthreads(nthreads), cost_model(cost_model), queues(nthreads),
+      queue_locks(nthreads), remaining_dependencies(graph.size()), queued_count(0),
+      finished_count(0) {
+  vector<int> ready;
+  for (uint i = 0; i < graph.size(); i++) {
+    if (graph[i].complete) {
+      finished_count++;
+      continue;
+    }
+    remaining_dependencies[i] = 0;
+    for (int dependency : graph[i].dependencies)
+      if (!graph[dependency].complete)
+        remaining_dependencies[i]++;
+    if (remaining_dependencies[i] == 0)
+      ready.push_back(i);
+  }
+  if (cost_model != NULL)
+    cost_model->sort_longest_first(graph, ready);
+  for (uint i = 0; i < ready.size(); i++)
+    push_task(i % nthreads, ready[i], false);
+}
+
+void WorkStealingScheduler::push_task(int id, int task, bool front) {
+  {
+    lock_guard<mutex> lock(queue_locks[id]);
+    if (front)
+      queues[id].push_front(task);
+    else
+      queues[id].push_back(task);
+  }
+  queued_count++;
+  lock_guard<mutex> lock(idle_lock);
+  idle.notify_all();
+}
+
+bool WorkStealingScheduler::next_task(int id, int &task) {
+  for (int i = 0; i < nthreads; i++) {
+    int victim = (id + i) % nthreads;
+    lock_guard<mutex> lock(queue_locks[victim]);
+    if (queues[victim].empty())
+      continue;
+    if (victim == id) {
+      task = queues[victim].front();
+      queues[victim].pop_front();
+    } else {
+      task = queues[victim].back();
+      queues[victim].pop_back();
+    }
+    queued_count--;
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingScheduler::complete_task(int id, int task) {
+  vector<int> ready;
+  for (int dependent : graph[task].dependents)
+    if (--remaining_dependencies[dependent] == 0)
+      ready.push_back(dependent);
+  if (cost_model != NULL)
+    cost_model->sort_longest_first(graph, ready);
+  for (int i = ready.size() - 1; i >= 0; i--)
+    push_task(id, ready[i], true);
+  finished_count++;
+  lock_guard<mutex> lock(idle_lock);
+  idle.notify_all();
+}
+
+void WorkStealingScheduler::worker(int id) {
+  int total = graph.size();
+  while (true) {
+    int task;
+    if (next_task(id, task)) {
+      run_journaled_task(graph[task], id);
+      complete_task(id, task);
+      continue;
+    }
+    unique_lock<mutex> lock(idle_lock);
+    if (finished_count == total)
+      break;
+    idle.wait(lock, [&] { return queued_count > 0 || finished_count == total; });
+  }
+  write_to_logfile(id, "driver", "Done\n");
+}
+
+void WorkStealingScheduler::run() {
+  mkdir(convert_string(file_storage_location + "debug1"), 0770);
+  mkdir(convert_string(file_storage_location + "debug1/driver_logfiles"), 0770);
+  for (DriverTask &driver_task : graph)
+    mkdir(convert_string(file_storage_location + "debug1/" + driver_task.process + "_logfiles"),
+          0770);
+
+  vector<thread> workers;
+  for (int i = 0; i < nthreads; i++)
+    workers.push_back(thread(&WorkStealingScheduler::worker, this, i));
+  for (thread &t : workers)
+    t.join();
+}
@@ -0,0 +1,47 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "phes_base.h"
+#include "task_graph.hpp"
+#include "task_cost.hpp"
+
+void write_to_logfile(int id, string process, string message);
+
+// Runs a single process for a task within this thread, falling back to ./bin/<process> for
+// processes without an in-process implementation. Retries up to 5 times, returning false if the
+// task never succeeded.
+bool run_driver_task(DriverTask &driver_task, int worker_id);
+
+// Runs the task as above, recording it in the driver journal
+bool run_journaled_task(DriverTask &driver_task, int worker_id);
+
+// Runs every task in the graph on a pool of worker threads. Each worker takes ready tasks from the
+// front of its own queue and steals from the back of the other queues when its own is empty. Tasks
+// released by a finished task are queued at the front of the finishing worker, so dependent
+// processes on the same cell tend to run next on the same thread. Tasks marked complete are not
+// run again. With a cost model, ready tasks are queued longest predicted runtime first.
+class WorkStealingScheduler {
+  public:
+    WorkStealingScheduler(vector<DriverTask> &graph, int nthreads,
+                          TaskCostModel *cost_model = NULL);
+    void run();
+
+  private:
+    void worker(int id);
+    bool next_task(int id, int &task);
+    void push_task(int id, int task, bool front);
+    void complete_task(int id, int task);
+
+    vector<DriverTask> &graph;
+    int nthreads;
+    TaskCostModel *cost_model;
+    vector<deque<int>> queues;
+    vector<mutex> queue_locks;
+    vector<atomic<int>> remaining_dependencies;
+    atomic<int> queued_count;
+    atomic<int> finished_count;
+    mutex idle_lock;
+    condition_variable idle;
+};
+
+#endif
@@ -0,0 +1,3 @@
+#include "scratch.hpp"
+
+thread_local Scratch scratch;
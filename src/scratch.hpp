@@ -0,0 +1,33 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include "phes_base.h"
+
+// FIFO of the cells still to visit in a flood. Cells are appended to one vector and read from the
+// front, so clearing keeps the storage for the next flood instead of freeing it.
+class Frontier {
+public:
+  void clear() {
+    cells.clear();
+    head = 0;
+  }
+  bool empty() const { return head == cells.size(); }
+  void push(GridPoint p) { cells.push_back(p); }
+  GridPoint pop() { return cells[head++]; }
+
+private:
+  vector<GridPoint> cells;
+  size_t head = 0;
+};
+
+// Buffers reused by the floods on a thread. A flood clears what it uses before starting, and
+// floods do not nest, so one set per thread is enough.
+struct Scratch {
+  Frontier frontier;
+  // The raster a reservoir is traced on. It only grows, and a reservoir zeroes the part it uses.
+  unique_ptr<Model<char>> reservoir_raster;
+};
+
+extern thread_local Scratch scratch;
+
+#endif
@@ -1,8 +1,11 @@
+#include "cell_sizes.hpp"
 #include "coordinates.h"
 #include "model2D.h"
 #include "phes_base.h"
 #include "reservoir.h"
+#include "scratch.hpp"
 #include "search_config.hpp"
+#include "stages.hpp"
 #include <climits>
 
 bool debug_output = false;
@@ -38,6 +41,7 @@ string find_world_utm_filename(GeographicCoordinate point){
 
 Model<bool>* read_filter(Model<short>* DEM, vector<string> filenames)
 {
+	ScopedTimer timer("read_filter");
 	Model<bool>* filter = new Model<bool>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
 	filter->set_geodata(DEM->get_geodata());
 	for(string filename:filenames){
@@ -72,7 +76,7 @@ Model<bool>* read_filter(Model<short>* DEM, vector<string> filenames)
           read_shp_filter(shp_filename, filter);
         else{
           search_config.logger.debug("Couldn't find file " + shp_filename);
-          search_config.logger.debug(to_string(i));
+          search_config.logger.debug(i);
           if(i==0)
             throw(1);
 
@@ -92,6 +96,7 @@ Model<bool>* read_filter(Model<short>* DEM, vector<string> filenames)
 
 Model<double>* fill(Model<short>* DEM)
 {
+	ScopedTimer timer("fill");
 	Model<double>* DEM_filled_no_flat = new Model<double>(DEM->nrows(), DEM->ncols(), MODEL_UNSET);
 	DEM_filled_no_flat->set_geodata(DEM->get_geodata());
 	Model<bool>* seen = new Model<bool>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
@@ -152,6 +157,7 @@ Model<double>* fill(Model<short>* DEM)
 
 Model<bool>* find_ocean(Model<short>* DEM)
 {
+	ScopedTimer timer("find_ocean");
 	Model<bool>* ocean = new Model<bool>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
 	ocean->set_geodata(DEM->get_geodata());
 
@@ -236,16 +242,17 @@ int find_lowest_neighbor(int row, int col, Model<double>* DEM_filled_no_flat, do
 		}
 	}
 	if(min_drop==0)
-		search_config.logger.debug("Alert: Minimum drop of 0 at " + to_string(row) + " " + to_string(col));
+		search_config.logger.debug("Alert: Minimum drop of 0 at ", row, " ", col);
 	return result;
 }
 
 // Find the direction of flow for each square in a filled DEM
-static Model<char>* flow_direction(Model<double>* DEM_filled_no_flat)
+static Model<char>* flow_direction(Model<double>* DEM_filled_no_flat, const SearchParameters &params)
 {
+	ScopedTimer timer("flow_direction");
 	Model<char>* flow_dirn = new Model<char>(DEM_filled_no_flat->nrows(), DEM_filled_no_flat->ncols(), MODEL_UNSET);
 	flow_dirn->set_geodata(DEM_filled_no_flat->get_geodata());
-	double coslat = COS(RADIANS(flow_dirn->get_origin().lat-(0.5+border/(double)(flow_dirn->nrows()-2*border))));
+	double coslat = COS(RADIANS(flow_dirn->get_origin().lat-(0.5+params.border/(double)(flow_dirn->nrows()-2*params.border))));
 	for (int row=1; row<flow_dirn->nrows()-1;row++)
 		for (int col=1; col<flow_dirn->ncols()-1; col++)
 			flow_dirn->set(row,col,find_lowest_neighbor(row, col, DEM_filled_no_flat, coslat));
@@ -268,6 +275,7 @@ static Model<char>* flow_direction(Model<double>* DEM_filled_no_flat)
 // Calculate flow accumulation given a DEM and the flow directions
 static Model<int>* find_flow_accumulation(Model<char>* flow_directions, Model<double>* DEM_filled_no_flat)
 {
+	ScopedTimer timer("find_flow_accumulation");
 	Model<int>* flow_accumulation = new Model<int>(DEM_filled_no_flat->nrows(), DEM_filled_no_flat->ncols(), MODEL_SET_ZERO);
 	flow_accumulation->set_geodata(DEM_filled_no_flat->get_geodata());
 
@@ -296,125 +304,133 @@ static Model<int>* find_flow_accumulation(Model<char>* flow_directions, Model<do
 }
 
 // Find streams given the flow accumulation
-static Model<bool>* find_streams(Model<int>* flow_accumulation)
+static Model<bool>* find_streams(Model<int>* flow_accumulation, const SearchParameters &params)
 {
+	ScopedTimer timer("find_streams");
 	Model<bool>* streams = new Model<bool>(flow_accumulation->nrows(), flow_accumulation->ncols(), MODEL_SET_ZERO);
 	streams->set_geodata(flow_accumulation->get_geodata());
 	int stream_site_count=0;
 	for (int row=0; row<flow_accumulation->nrows(); row++)
 		for (int col=0; col<flow_accumulation->ncols();col++)
-			if(flow_accumulation->get(row,col) >= stream_threshold){
+			if(flow_accumulation->get(row,col) >= params.stream_threshold){
 				streams->set(row,col,true);
 				stream_site_count++;
 			}
-	search_config.logger.debug("Number of stream sites = "+  to_string(stream_site_count));
+	search_config.logger.debug("Number of stream sites = ", stream_site_count);
 	return streams;
 }
 
 
 // Find dam sites to check given the streams, flow directions and DEM
-static Model<bool>* find_pour_points(Model<bool>* streams, Model<char>* flow_directions, Model<short>* DEM_filled)
+static Model<bool>* find_pour_points(Model<bool>* streams, Model<char>* flow_directions, Model<short>* DEM_filled,
+                                     const SearchParameters &params)
 {
+	ScopedTimer timer("find_pour_points");
 	Model<bool>* pour_points = new Model<bool>(streams->nrows(), streams->ncols(), MODEL_SET_ZERO);
 	pour_points->set_geodata(streams->get_geodata());
 	int pour_point_count=0;
-	for (int row = border; row < border+pour_points->nrows()-2*border; row++)
-		for (int col = border; col <  border+pour_points->ncols()-2*border; col++)
+	for (int row = params.border; row < params.border+pour_points->nrows()-2*params.border; row++)
+		for (int col = params.border; col <  params.border+pour_points->ncols()-2*params.border; col++)
 			if (streams->get(row,col)) {
 				ArrayCoordinate downstream = ArrayCoordinate_init(row+directions[flow_directions->get(row,col)].row,col+directions[flow_directions->get(row,col)].col, GeographicCoordinate_init(0,0));
         if ( flow_directions->check_within(downstream.row, downstream.col)){
           if(DEM_filled->get(row,col) >= 0){
-            if(DEM_filled->get(row,col)-DEM_filled->get(row,col)%contour_height>DEM_filled->get(downstream.row,downstream.col)) {
+            if(DEM_filled->get(row,col)-DEM_filled->get(row,col)%params.contour_height>DEM_filled->get(downstream.row,downstream.col)) {
               pour_points->set(row,col,true);
               pour_point_count++;
             }
           } else {
-            if(DEM_filled->get(row,col)+DEM_filled->get(row,col)%contour_height>DEM_filled->get(downstream.row,downstream.col)) {
+            if(DEM_filled->get(row,col)+DEM_filled->get(row,col)%params.contour_height>DEM_filled->get(downstream.row,downstream.col)) {
               pour_points->set(row,col,true);
               pour_point_count++;
             }
           }
         }
 			}
-	search_config.logger.debug("Number of dam sites = "+  to_string(pour_point_count));
+	search_config.logger.debug("Number of dam sites = ", pour_point_count);
+	metrics.count(POUR_POINTS, pour_point_count);
 	return pour_points;
 }
 
 // Find details of possible reservoirs at pour_point
 static RoughGreenfieldReservoir model_greenfield_reservoir(ArrayCoordinate pour_point, Model<char>* flow_directions, Model<short>* DEM_filled, Model<bool>* filter,
-				  Model<int>* modelling_array, int iterator)
+				  Model<int>* modelling_array, int iterator, CellSizes &cell_sizes, const SearchParameters &params)
 {
 
-	RoughGreenfieldReservoir reservoir = RoughGreenfieldReservoir(RoughReservoir(pour_point, convert_to_int(DEM_filled->get(pour_point.row,pour_point.col))));
-
-  double area_at_elevation[max_wall_height + 1];
-  double cumulative_area_at_elevation[max_wall_height + 1];
-  double volume_at_elevation[max_wall_height + 1];
-  double dam_length_at_elevation[max_wall_height + 1];
-  std::memset(area_at_elevation, 0, (max_wall_height+1)*sizeof(double));
-  std::memset(volume_at_elevation, 0, (max_wall_height+1)*sizeof(double));
-  std::memset(cumulative_area_at_elevation, 0, (max_wall_height+1)*sizeof(double));
-  std::memset(dam_length_at_elevation, 0, (max_wall_height+1)*sizeof(double));
-
-	queue<ArrayCoordinate> q;
-	q.push(pour_point);
+	RoughGreenfieldReservoir reservoir = RoughGreenfieldReservoir(RoughReservoir(pour_point, convert_to_int(DEM_filled->get(pour_point.row,pour_point.col))), params.dam_wall_heights);
+
+  double area_at_elevation[params.max_wall_height + 1];
+  double cumulative_area_at_elevation[params.max_wall_height + 1];
+  double volume_at_elevation[params.max_wall_height + 1];
+  double dam_length_at_elevation[params.max_wall_height + 1];
+  std::memset(area_at_elevation, 0, (params.max_wall_height+1)*sizeof(double));
+  std::memset(volume_at_elevation, 0, (params.max_wall_height+1)*sizeof(double));
+  std::memset(cumulative_area_at_elevation, 0, (params.max_wall_height+1)*sizeof(double));
+  std::memset(dam_length_at_elevation, 0, (params.max_wall_height+1)*sizeof(double));
+
+	long &cells_flooded = metrics.counters[CELLS_FLOODED];
+	GeographicCoordinate origin = pour_point.origin;
+	GridPoint start = {pour_point.row, pour_point.col};
+	Frontier &q = scratch.frontier;
+	q.clear();
+	q.push(start);
 	while (!q.empty()) {
-		ArrayCoordinate p = q.front();
-		q.pop();
+		GridPoint p = q.pop();
+		cells_flooded++;
 
 		int elevation = convert_to_int(DEM_filled->get(p.row,p.col));
 		int elevation_above_pp = MAX(elevation - reservoir.elevation, 0);
 
-		update_reservoir_boundary(reservoir.shape_bound, p, elevation_above_pp);
+		update_reservoir_boundary(reservoir.shape_bound, p, elevation_above_pp, params.dam_wall_heights);
 
 		if (filter->get(p.row,p.col))
 			reservoir.max_dam_height = MIN(reservoir.max_dam_height,elevation_above_pp);
 
-		area_at_elevation[elevation_above_pp+1] += find_area(p);
+		area_at_elevation[elevation_above_pp+1] += cell_sizes.area(p, origin);
 		modelling_array->set(p.row,p.col,iterator);
 
 		for (uint d=0; d<directions.size(); d++) {
-			ArrayCoordinate neighbor = {p.row+directions[d].row, p.col+directions[d].col, p.origin};
+			GridPoint neighbor = {p.row+directions[d].row, p.col+directions[d].col};
 			if (flow_directions->check_within(neighbor.row, neighbor.col) &&
 			    flow_directions->flows_to(neighbor, p) &&
-			    (convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-DEM_filled->get(pour_point.row,pour_point.col)) < max_wall_height) ) {
+			    (convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-DEM_filled->get(pour_point.row,pour_point.col)) < params.max_wall_height) ) {
 				q.push(neighbor);
 			}
 		}
 	}
 
-	for (int ih=1; ih<max_wall_height+1;ih++) {
+	for (int ih=1; ih<params.max_wall_height+1;ih++) {
 		cumulative_area_at_elevation[ih] = cumulative_area_at_elevation[ih-1] + area_at_elevation[ih];
 		volume_at_elevation[ih] = volume_at_elevation[ih-1] + 0.01*cumulative_area_at_elevation[ih]; // area in ha, vol in GL
 	}
 
-	q.push(pour_point);
+	q.clear();
+	q.push(start);
 	while (!q.empty()) {
-		ArrayCoordinate p = q.front();
-		q.pop();
+		GridPoint p = q.pop();
 		int elevation = convert_to_int(DEM_filled->get(p.row,p.col));
 		int elevation_above_pp = MAX(elevation - reservoir.elevation,0);
 		for (uint d=0; d<directions.size(); d++) {
-			ArrayCoordinate neighbor = {p.row+directions[d].row, p.col+directions[d].col, p.origin};
+			GridPoint neighbor = {p.row+directions[d].row, p.col+directions[d].col};
 			if (flow_directions->check_within(neighbor.row, neighbor.col)){
 				if(flow_directions->flows_to(neighbor, p) &&
-          (convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-DEM_filled->get(pour_point.row,pour_point.col)) < max_wall_height) ) {
+          (convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-DEM_filled->get(pour_point.row,pour_point.col)) < params.max_wall_height) ) {
 					q.push(neighbor);
 				}
 				if ((directions[d].row * directions[d].col == 0) // coordinate orthogonal directions
 				    && (modelling_array->get(neighbor.row,neighbor.col) < iterator ) ){
-					dam_length_at_elevation[MIN(MAX(elevation_above_pp, convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-reservoir.elevation)),max_wall_height)] +=find_orthogonal_nn_distance(p, neighbor);	//WE HAVE PROBLEM IF VALUE IS NEGATIVE???
+					dam_length_at_elevation[MIN(MAX(elevation_above_pp, convert_to_int(DEM_filled->get(neighbor.row,neighbor.col)-reservoir.elevation)),params.max_wall_height)] +=cell_sizes.orthogonal_nn_distance(p, neighbor, origin);	//WE HAVE PROBLEM IF VALUE IS NEGATIVE???
 				}
 			}
 		}
 	}
 
-	for (uint ih =0 ; ih< dam_wall_heights.size(); ih++) {
-		int height = dam_wall_heights[ih];
+	for (uint ih =0 ; ih< params.dam_wall_heights.size(); ih++) {
+		int height = params.dam_wall_heights[ih];
 		reservoir.areas.push_back(cumulative_area_at_elevation[height]);
 		reservoir.dam_volumes.push_back(0);
 		for (int jh=0; jh < height; jh++)
-			reservoir.dam_volumes[ih] += convert_to_dam_volume(height-jh, dam_length_at_elevation[jh]);
+			reservoir.dam_volumes[ih] += convert_to_dam_volume(height-jh, dam_length_at_elevation[jh], params);
 		reservoir.volumes.push_back(volume_at_elevation[height] + 0.5*reservoir.dam_volumes[ih]);
 		reservoir.water_rocks.push_back(reservoir.volumes[ih]/reservoir.dam_volumes[ih]);
 	}
@@ -422,54 +438,21 @@ static RoughGreenfieldReservoir model_greenfield_reservoir(ArrayCoordinate pour_
 	return reservoir;
 }
 
-static int
+static vector<unique_ptr<RoughReservoir>>
 model_reservoirs(GridSquare square_coordinate, Model<bool> *pour_points,
                  Model<char> *flow_directions, Model<short> *DEM_filled,
-                 Model<int> *flow_accumulation, Model<bool> *filter) {
-  FILE *csv_file;
-  if (search_config.search_type == SearchType::OCEAN)
-    csv_file = fopen(convert_string(file_storage_location +
-                                    "output/reservoirs/ocean_" +
-                                    str(square_coordinate) + "_reservoirs.csv"),
-                     "w");
-  else
-    csv_file =
-        fopen(convert_string(file_storage_location + "output/reservoirs/" +
-                             str(square_coordinate) + "_reservoirs.csv"),
-              "w");
-  if (!csv_file) {
-    cout << "Failed to open reservoir CSV file" << endl;
-    exit(1);
-  }
-  write_rough_reservoir_csv_header(csv_file);
-
-  FILE *csv_data_file;
-  if (search_config.search_type == SearchType::OCEAN)
-    csv_data_file =
-        fopen(convert_string(file_storage_location +
-                             "processing_files/reservoirs/ocean_" +
-                             str(square_coordinate) + "_reservoirs_data.csv"),
-              "w");
-  else
-    csv_data_file = fopen(
-        convert_string(file_storage_location + "processing_files/reservoirs/" +
-                       str(square_coordinate) + "_reservoirs_data.csv"),
-        "w");
-  if (!csv_file) {
-    fprintf(stderr, "failed to open reservoir CSV data file\n");
-    exit(1);
-  }
-  write_rough_reservoir_data_header(csv_data_file);
-
+                 Model<int> *flow_accumulation, Model<bool> *filter,
+                 const SearchParameters &params) {
+  ScopedTimer timer("model_reservoirs");
+  vector<unique_ptr<RoughReservoir>> reservoirs;
   int i = 0;
-  int count = 0;
   Model<int> *model = new Model<int>(pour_points->nrows(), pour_points->ncols(),
                                      MODEL_SET_ZERO);
 
   if (search_config.search_type == SearchType::OCEAN) {
-    unique_ptr<ArrayCoordinate> pp(new ArrayCoordinate{-1, -1, get_origin(square_coordinate, border)});
-    for (int row = border + 1; row < border + DEM_filled->nrows() - 2 * border - 1; row++)
-      for (int col = border + 1; col < border + DEM_filled->ncols() - 2 * border - 1; col++) {
+    unique_ptr<ArrayCoordinate> pp(new ArrayCoordinate{-1, -1, get_origin(square_coordinate, params.border)});
+    for (int row = params.border + 1; row < params.border + DEM_filled->nrows() - 2 * params.border - 1; row++)
+      for (int col = params.border + 1; col < params.border + DEM_filled->ncols() - 2 * params.border - 1; col++) {
         if (filter->get(row, col))
           continue;
         if (DEM_filled->get(row, col) >= 1 - EPS &&
@@ -485,195 +468,257 @@ model_reservoirs(GridSquare square_coordinate, Model<bool> *pour_points,
       reservoir.ocean = true;
       reservoir.watershed_area = 0;
       reservoir.max_dam_height = 0;
-      for (uint ih = 0; ih < dam_wall_heights.size(); ih++) {
+      for (uint ih = 0; ih < params.dam_wall_heights.size(); ih++) {
         reservoir.areas.push_back(0);
         reservoir.dam_volumes.push_back(0);
         reservoir.volumes.push_back(INF);
         reservoir.water_rocks.push_back(INF);
       }
-      for (int row = border + 1; row < border + DEM_filled->nrows() - 2 * border - 1; row++)
-        for (int col = border + 1; col < border + DEM_filled->ncols() - 2 * border - 1; col++) {
+      for (int row = params.border + 1; row < params.border + DEM_filled->nrows() - 2 * params.border - 1; row++)
+        for (int col = params.border + 1; col < params.border + DEM_filled->ncols() - 2 * params.border - 1; col++) {
           if (filter->get(row, col))
             continue;
           if (DEM_filled->get(row, col) >= 1 - EPS &&
               pour_points->get(row + directions.at(flow_directions->get(row, col)).row,
                                col + directions.at(flow_directions->get(row, col)).col) == true) {
-            ArrayCoordinate pour_point = {row, col, get_origin(square_coordinate, border)};
-            reservoir.shape_bound.push_back(pour_point);
-            count++;
+            reservoir.shape_bound.push_back({row, col});
           }
         }
-      write_rough_reservoir_csv(csv_file, reservoir);
-      write_rough_reservoir_data(csv_data_file, &reservoir);
+      reservoirs.push_back(unique_ptr<RoughReservoir>(new RoughBfieldReservoir(reservoir)));
     }
   } else {
-    for (int row = border; row < border + DEM_filled->nrows() - 2 * border; row++)
-      for (int col = border; col < border + DEM_filled->ncols() - 2 * border; col++) {
+    CellSizes cell_sizes(get_origin(square_coordinate, params.border), DEM_filled->nrows());
+    for (int row = params.border; row < params.border + DEM_filled->nrows() - 2 * params.border; row++)
+      for (int col = params.border; col < params.border + DEM_filled->ncols() - 2 * params.border; col++) {
         if (!pour_points->get(row, col) || filter->get(row, col))
           continue;
-        ArrayCoordinate pour_point = {row, col, get_origin(square_coordinate, border)};
+        ArrayCoordinate pour_point = {row, col, get_origin(square_coordinate, params.border)};
         i++;
         RoughGreenfieldReservoir reservoir =
-            model_greenfield_reservoir(pour_point, flow_directions, DEM_filled, filter, model, i);
+            model_greenfield_reservoir(pour_point, flow_directions, DEM_filled, filter, model, i, cell_sizes, params);
+        metrics.count(RESERVOIRS_MODELLED);
         reservoir.ocean = false;
-        if (max(reservoir.volumes) >= min_reservoir_volume &&
-            max(reservoir.water_rocks) > min_reservoir_water_rock &&
-            reservoir.max_dam_height >= min_max_dam_height) {
+        if (max(reservoir.volumes) >= params.min_reservoir_volume &&
+            max(reservoir.water_rocks) > params.min_reservoir_water_rock &&
+            reservoir.max_dam_height >= params.min_max_dam_height) {
           reservoir.watershed_area = find_area(pour_point) * flow_accumulation->get(row, col);
 
           reservoir.identifier = str(square_coordinate) + "_RES" + str(i);
-
-          write_rough_reservoir_csv(csv_file, reservoir);
-          write_rough_reservoir_data(csv_data_file, &reservoir);
-          count++;
+          reservoirs.push_back(unique_ptr<RoughReservoir>(new RoughGreenfieldReservoir(reservoir)));
         }
       }
   }
+  delete model;
+  return reservoirs;
+}
+
+static void write_reservoirs(GridSquare square_coordinate,
+                             vector<unique_ptr<RoughReservoir>> &reservoirs) {
+  ScopedTimer timer("write_reservoirs");
+  FILE *csv_file;
+  if (search_config.search_type == SearchType::OCEAN)
+    csv_file = fopen(convert_string(file_storage_location +
+                                    "output/reservoirs/ocean_" +
+                                    str(square_coordinate) + "_reservoirs.csv"),
+                     "w");
+  else
+    csv_file =
+        fopen(convert_string(file_storage_location + "output/reservoirs/" +
+                             str(square_coordinate) + "_reservoirs.csv"),
+              "w");
+  if (!csv_file) {
+    cout << "Failed to open reservoir CSV file" << endl;
+    throw(1);
+  }
+  write_rough_reservoir_csv_header(csv_file);
+
+  FILE *csv_data_file;
+  if (search_config.search_type == SearchType::OCEAN)
+    csv_data_file =
+        fopen(convert_string(file_storage_location +
+                             "processing_files/reservoirs/ocean_" +
+                             str(square_coordinate) + "_reservoirs_data.csv"),
+              "w");
+  else
+    csv_data_file = fopen(
+        convert_string(file_storage_location + "processing_files/reservoirs/" +
+                       str(square_coordinate) + "_reservoirs_data.csv"),
+        "w");
+  if (!csv_data_file) {
+    fprintf(stderr, "failed to open reservoir CSV data file\n");
+    throw(1);
+  }
+  write_rough_reservoir_data_header(csv_data_file);
+
+  CSVWriter csv(csv_file), csv_data(csv_data_file);
+  for (unique_ptr<RoughReservoir> &reservoir : reservoirs) {
+    write_rough_reservoir_csv(csv, *reservoir);
+    write_rough_reservoir_data(csv_data, reservoir.get());
+  }
+  csv.flush();
+  csv_data.flush();
+  count_file_written(csv_file);
+  count_file_written(csv_data_file);
   fclose(csv_file);
   fclose(csv_data_file);
-  return count;
-  }
+}
 
-int main(int nargs, char **argv) {
-  search_config = SearchConfig(nargs, argv);
-  cout << "Screening started for " << search_config.filename() << endl;
+ScreeningResult screen_grid_square(GridSquare square, const SearchParameters &params) {
+  unsigned long t_usec;
 
-  GDALAllRegister();
-  parse_variables(convert_string("storage_location"));
-  parse_variables(convert_string(file_storage_location + "variables"));
-  unsigned long start_usec = walltime_usec();
-  unsigned long t_usec = start_usec;
+  Model<short> *DEM = read_DEM_with_borders(square, params.border);
 
-  mkdir(convert_string(file_storage_location + "output"), 0777);
-  mkdir(convert_string(file_storage_location + "output/reservoirs"), 0777);
-  mkdir(convert_string(file_storage_location + "processing_files"), 0777);
-  mkdir(convert_string(file_storage_location + "processing_files/reservoirs"), 0777);
+  if (search_config.logger.output_debug()) {
+    printf("\nAfter border added:\n");
+    DEM->print();
+  }
+  if (debug_output) {
+    mkdir(convert_string("debug"), 0777);
+    mkdir(convert_string("debug/input"), 0777);
+    DEM->write("debug/input/" + str(square) + "_input.tif", GDT_Int16);
+  }
 
-  if (search_config.search_type.not_existing()) {
-    Model<short> *DEM = read_DEM_with_borders(search_config.grid_square, border);
+  Model<char> *flow_directions;
+  Model<bool> *pour_points;
+  Model<int> *flow_accumulation;
+  Model<short> *DEM_filled;
+  Model<bool> *filter;
+
+  //filter = new Model<bool>(file_storage_location+"debug/filter/"+str(square)+"_filter.tif", GDT_Byte);
+  //DEM_filled = new Model<short>(file_storage_location+"debug/DEM_filled/"+str(square)+"_DEM_filled.tif", GDT_Int16);
+  //flow_directions = new Model<char>(file_storage_location+"debug/flow_directions/"+str(square)+"_flow_directions.tif", GDT_Byte);
+  //flow_accumulation =  new Model<int>(file_storage_location+"debug/flow_accumulation/"+str(square)+"_flow_accumulation.tif", GDT_Int32);
+  //pour_points = new Model<bool>(file_storage_location+"debug/pour_points/"+str(square)+"_pour_points.tif", GDT_Byte);
+  t_usec = walltime_usec();
+  filter = read_filter(DEM, params.filter_filenames);
+  if (search_config.logger.output_debug()) {
+    printf("\nFilter:\n");
+    filter->print();
+    printf("Filter Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+  }
+  if(debug_output){
+    mkdir(convert_string(file_storage_location+"debug/filter"),0777);
+    filter->write(file_storage_location+"debug/filter/"+str(square)+"_filter.tif", GDT_Byte);
+  }
 
-    if (search_config.logger.output_debug()) {
-      printf("\nAfter border added:\n");
-      DEM->print();
-    }
-    if (debug_output) {
-      mkdir(convert_string("debug"), 0777);
-      mkdir(convert_string("debug/input"), 0777);
-      DEM->write("debug/input/" + str(search_config.grid_square) + "_input.tif", GDT_Int16);
-    }
+  t_usec = walltime_usec();
+  Model<double>* DEM_filled_no_flat = fill(DEM);
+  DEM_filled = new Model<short>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
+  DEM_filled->set_geodata(DEM->get_geodata());
+  for(int row = 0; row<DEM->nrows();row++)
+    for(int col = 0; col<DEM->ncols();col++)
+      DEM_filled->set(row, col, convert_to_int(DEM_filled_no_flat->get(row, col)));
+  if (search_config.logger.output_debug()) {
+    printf("\nFilled No Flats:\n");
+    DEM_filled_no_flat->print();
+    printf("Fill Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+  }
+  if(debug_output){
+    mkdir(convert_string(file_storage_location+"debug/DEM_filled"),0777);
+    DEM_filled->write(file_storage_location+"debug/DEM_filled/"+str(square)+"_DEM_filled.tif", GDT_Int16);
+    DEM_filled_no_flat->write(file_storage_location+"debug/DEM_filled/"+str(square)+"_DEM_filled_no_flat.tif",GDT_Float64);
+  }
 
-    Model<char> *flow_directions;
-    Model<bool> *pour_points;
-    Model<int> *flow_accumulation;
-    Model<short> *DEM_filled;
-    Model<bool> *filter;
-
-    //filter = new Model<bool>(file_storage_location+"debug/filter/"+str(search_config.grid_square)+"_filter.tif", GDT_Byte);
-    //DEM_filled = new Model<short>(file_storage_location+"debug/DEM_filled/"+str(search_config.grid_square)+"_DEM_filled.tif", GDT_Int16);
-    //flow_directions = new Model<char>(file_storage_location+"debug/flow_directions/"+str(search_config.grid_square)+"_flow_directions.tif", GDT_Byte);
-    //flow_accumulation =  new Model<int>(file_storage_location+"debug/flow_accumulation/"+str(search_config.grid_square)+"_flow_accumulation.tif", GDT_Int32);
-    //pour_points = new Model<bool>(file_storage_location+"debug/pour_points/"+str(search_config.grid_square)+"_pour_points.tif", GDT_Byte);
-    t_usec = walltime_usec();
-    filter = read_filter(DEM, filter_filenames);
-    if (search_config.logger.output_debug()) {
-      printf("\nFilter:\n");
-      filter->print();
-      printf("Filter Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
-    }
-    if(debug_output){
-      mkdir(convert_string(file_storage_location+"debug/filter"),0777);
-      filter->write(file_storage_location+"debug/filter/"+str(search_config.grid_square)+"_filter.tif", GDT_Byte);
-    }
+  t_usec = walltime_usec();
+  flow_directions = flow_direction(DEM_filled_no_flat, params);
+  if (search_config.logger.output_debug()) {
+    printf("\nFlow Directions:\n");
+    flow_directions->print();
+    printf("Flow directions Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+  }
+  if(debug_output){
+    mkdir(convert_string(file_storage_location+"debug/flow_directions"),0777);
+    flow_directions->write(file_storage_location+"debug/flow_directions/"+str(square)+"_flow_directions.tif",GDT_Byte);
+  }
 
-    t_usec = walltime_usec();
-    Model<double>* DEM_filled_no_flat = fill(DEM);
-    DEM_filled = new Model<short>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
-    DEM_filled->set_geodata(DEM->get_geodata());
-    for(int row = 0; row<DEM->nrows();row++)
-      for(int col = 0; col<DEM->ncols();col++)
-        DEM_filled->set(row, col, convert_to_int(DEM_filled_no_flat->get(row, col)));
+  t_usec = walltime_usec();
+  flow_accumulation = find_flow_accumulation(flow_directions, DEM_filled_no_flat);
+  if (search_config.logger.output_debug()) {
+    printf("\nFlow Accumulation:\n");
+    flow_accumulation->print();
+    printf("Flow accumulation Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+  }
+  if(debug_output){
+    mkdir(convert_string(file_storage_location+"debug/flow_accumulation"),0777);
+    flow_accumulation->write(file_storage_location+"debug/flow_accumulation/"+str(square)+"_flow_accumulation.tif", GDT_Int32);
+  }
+  delete DEM_filled_no_flat;
+
+  if(search_config.search_type == SearchType::OCEAN){
+    pour_points = find_ocean(DEM);
     if (search_config.logger.output_debug()) {
-      printf("\nFilled No Flats:\n");
-      DEM_filled_no_flat->print();
-      printf("Fill Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+      printf("\nOcean\n");
+      pour_points->print();
     }
     if(debug_output){
-      mkdir(convert_string(file_storage_location+"debug/DEM_filled"),0777);
-      DEM_filled->write(file_storage_location+"debug/DEM_filled/"+str(search_config.grid_square)+"_DEM_filled.tif", GDT_Int16);
-      DEM_filled_no_flat->write(file_storage_location+"debug/DEM_filled/"+str(search_config.grid_square)+"_DEM_filled_no_flat.tif",GDT_Float64);
+      mkdir(convert_string(file_storage_location+"debug/ocean"),0777);
+      pour_points->write(file_storage_location+"debug/ocean/"+str(square)+"_ocean.tif",GDT_Byte);
     }
+  }else{
+
 
-    t_usec = walltime_usec();
-    flow_directions = flow_direction(DEM_filled_no_flat);
+    Model<bool>* streams = find_streams(flow_accumulation, params);
     if (search_config.logger.output_debug()) {
-      printf("\nFlow Directions:\n");
-      flow_directions->print();
-      printf("Flow directions Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+      printf("\nStreams (Greater than %d accumulation):\n", params.stream_threshold);
+      streams->print();
     }
     if(debug_output){
-      mkdir(convert_string(file_storage_location+"debug/flow_directions"),0777);
-      flow_directions->write(file_storage_location+"debug/flow_directions/"+str(search_config.grid_square)+"_flow_directions.tif",GDT_Byte);
+      mkdir(convert_string(file_storage_location+"debug/streams"),0777);
+      streams->write(file_storage_location+"debug/streams/"+str(square)+"_streams.tif",GDT_Byte);
     }
-    mkdir(convert_string(file_storage_location+"processing_files/flow_directions"),0777);
-    flow_directions->write(file_storage_location+"processing_files/flow_directions/"+str(search_config.grid_square)+"_flow_directions.tif",GDT_Byte);
 
-    t_usec = walltime_usec();
-    flow_accumulation = find_flow_accumulation(flow_directions, DEM_filled_no_flat);
+    pour_points = find_pour_points(streams, flow_directions, DEM_filled, params);
     if (search_config.logger.output_debug()) {
-      printf("\nFlow Accumulation:\n");
-      flow_accumulation->print();
-      printf("Flow accumulation Runtime: %.2f sec\n", 1.0e-6*(walltime_usec() - t_usec) );
+      printf("\nPour points (Streams every %dm):\n", params.contour_height);
+      pour_points->print();
     }
     if(debug_output){
-      mkdir(convert_string(file_storage_location+"debug/flow_accumulation"),0777);
-      flow_accumulation->write(file_storage_location+"debug/flow_accumulation/"+str(search_config.grid_square)+"_flow_accumulation.tif", GDT_Int32);
+      mkdir(convert_string(file_storage_location+"debug/pour_points"),0777);
+      pour_points->write(file_storage_location+"debug/pour_points/"+str(square)+"_pour_points.tif",GDT_Byte);
     }
-    delete DEM_filled_no_flat;
+    delete streams;
+  }
 
-    if(search_config.search_type == SearchType::OCEAN){
-      pour_points = find_ocean(DEM);
-      if (search_config.logger.output_debug()) {
-        printf("\nOcean\n");
-        pour_points->print();
-      }
-      if(debug_output){
-        mkdir(convert_string(file_storage_location+"debug/ocean"),0777);
-        pour_points->write(file_storage_location+"debug/ocean/"+str(search_config.grid_square)+"_ocean.tif",GDT_Byte);
-      }
-    }else{
+  t_usec = walltime_usec();
+  ScreeningResult result;
+  result.flow_directions = flow_directions;
+  result.reservoirs = model_reservoirs(square, pour_points, flow_directions, DEM_filled, flow_accumulation, filter, params);
+  search_config.logger.debug("Found ", result.reservoirs.size(), " reservoirs. Runtime: ", 1.0e-6*(walltime_usec() - t_usec), " sec");
+  delete DEM;
+  delete filter;
+  delete DEM_filled;
+  delete flow_accumulation;
+  delete pour_points;
+  return result;
+}
 
+int run_screening() {
+  search_config.logger.set_stage("screening");
+  metrics.reset();
+  cout << "Screening started for " << search_config.filename() << endl;
+  const SearchParameters params = SearchParameters::from_variables();
 
-      Model<bool>* streams = find_streams(flow_accumulation);
-      if (search_config.logger.output_debug()) {
-        printf("\nStreams (Greater than %d accumulation):\n", stream_threshold);
-        streams->print();
-      }
-      if(debug_output){
-        mkdir(convert_string(file_storage_location+"debug/streams"),0777);
-        streams->write(file_storage_location+"debug/streams/"+str(search_config.grid_square)+"_streams.tif",GDT_Byte);
-      }
+  unsigned long start_usec = walltime_usec();
+  unsigned long t_usec = start_usec;
 
-      pour_points = find_pour_points(streams, flow_directions, DEM_filled);
-      if (search_config.logger.output_debug()) {
-        printf("\nPour points (Streams every %dm):\n", contour_height);
-        pour_points->print();
-      }
-      if(debug_output){
-        mkdir(convert_string(file_storage_location+"debug/pour_points"),0777);
-        pour_points->write(file_storage_location+"debug/pour_points/"+str(search_config.grid_square)+"_pour_points.tif",GDT_Byte);
-      }
-      delete streams;
-    }
+  mkdir(convert_string(file_storage_location + "output"), 0777);
+  mkdir(convert_string(file_storage_location + "output/reservoirs"), 0777);
+  mkdir(convert_string(file_storage_location + "processing_files"), 0777);
+  mkdir(convert_string(file_storage_location + "processing_files/reservoirs"), 0777);
 
-		t_usec = walltime_usec();
-		int count = model_reservoirs(search_config.grid_square, pour_points, flow_directions, DEM_filled, flow_accumulation, filter);
-		search_config.logger.debug("Found " + to_string(count) + " reservoirs. Runtime: " + to_string(1.0e-6*(walltime_usec() - t_usec)) + " sec");
-		printf(convert_string("Screening finished for "+search_config.search_type.prefix()+str(search_config.grid_square)+". Runtime: %.2f sec\n"), 1.0e-6*(walltime_usec() - start_usec) );
+  if (search_config.search_type.not_existing()) {
+    ScreeningResult result = screen_grid_square(search_config.grid_square, params);
+    mkdir(convert_string(file_storage_location+"processing_files/flow_directions"),0777);
+    result.flow_directions->write(file_storage_location+"processing_files/flow_directions/"+str(search_config.grid_square)+"_flow_directions.tif",GDT_Byte);
+    write_reservoirs(search_config.grid_square, result.reservoirs);
+    delete result.flow_directions;
+    search_config.logger.flush();
+    printf(convert_string("Screening finished for "+search_config.search_type.prefix()+str(search_config.grid_square)+". Runtime: %.2f sec\n"), 1.0e-6*(walltime_usec() - start_usec) );
   } else {
 	// Depression volume finding for pits
 	if (search_config.search_type == SearchType::BULK_PIT) {
 		t_usec = walltime_usec();
-		Model<short> *DEM = read_DEM_with_borders(search_config.grid_square, border);
+		Model<short> *DEM = read_DEM_with_borders(search_config.grid_square, params.border);
 		Model<double>* DEM_filled_no_flat = fill(DEM);
 		Model<short>* DEM_filled = new Model<short>(DEM->nrows(), DEM->ncols(), MODEL_SET_ZERO);
 		DEM_filled->set_geodata(DEM->get_geodata());
@@ -685,6 +730,9 @@ int main(int nargs, char **argv) {
 
 		depression_volume_finding(DEM_filled);
 		printf(convert_string("Volume finding finished for "+str(search_config.grid_square)+". Runtime: %.2f sec\n"), 1.0e-6*(walltime_usec() - t_usec) );
+		delete DEM;
+		delete DEM_filled_no_flat;
+		delete DEM_filled;
 	}
 
     FILE *csv_file = fopen(convert_string(file_storage_location + "output/reservoirs/" +
@@ -692,7 +740,7 @@ int main(int nargs, char **argv) {
                            "w");
     if (!csv_file) {
       cout << "Failed to open reservoir CSV file." << endl;
-      exit(1);
+      throw(1);
     }
 
     write_rough_reservoir_csv_header(csv_file);
@@ -704,7 +752,7 @@ int main(int nargs, char **argv) {
               "w");
     if (!csv_file) {
       fprintf(stderr, "failed to open reservoir CSV data file\n");
-      exit(1);
+      throw(1);
     }
     write_rough_reservoir_data_header(csv_data_file);
 
@@ -717,21 +765,25 @@ int main(int nargs, char **argv) {
 
     if (existing_reservoirs.size() < 1) {
       printf("No existing reservoirs in %s\n", convert_string(str(search_config.grid_square)));
-      exit(0);
+      fclose(csv_file);
+      fclose(csv_data_file);
+      write_metrics("screening");
+      return 0;
     }
-    if (search_config.search_type == SearchType::BULK_EXISTING && use_tiled_rivers) {
-      Model<short> *DEM = read_DEM_with_borders(search_config.grid_square, border);
+    CSVWriter csv(csv_file), csv_data(csv_data_file);
+    if (search_config.search_type == SearchType::BULK_EXISTING && params.use_tiled_rivers) {
+      Model<short> *DEM = read_DEM_with_borders(search_config.grid_square, params.border);
       Model<double> *DEM_filled_no_flat = fill(DEM);
       for (ExistingReservoir r : existing_reservoirs) {
         RoughBfieldReservoir reservoir = existing_reservoir_to_rough_reservoir(r);
         reservoir.pit = (search_config.search_type == SearchType::BULK_PIT ||
                          search_config.search_type == SearchType::SINGLE_PIT);
         if (reservoir.river) {
-          for (ArrayCoordinate ac : reservoir.shape_bound) {
+          for (GridPoint ac : reservoir.shape_bound) {
             int temp_elevation = INT_MAX;
             for (int dx = -5; dx < 6; dx++)
               for (int dy = -5; dy < 6; dy++) {
-                ArrayCoordinate n = ArrayCoordinate_init(ac.row + dy, ac.col + dx, ac.origin);
+                ArrayCoordinate n = ArrayCoordinate_init(ac.row + dy, ac.col + dx, reservoir.pour_point.origin);
                 if (DEM_filled_no_flat->check_within(n.row, n.col))
                   temp_elevation =
                       MIN(temp_elevation,
@@ -741,23 +793,32 @@ int main(int nargs, char **argv) {
           }
           reservoir.elevation = reservoir.elevations[0];
         }
-        write_rough_reservoir_csv(csv_file, reservoir);
-        write_rough_reservoir_data(csv_data_file, &reservoir);
+        write_rough_reservoir_csv(csv, reservoir);
+        write_rough_reservoir_data(csv_data, &reservoir);
       }
+      delete DEM;
+      delete DEM_filled_no_flat;
     } else {
       for (ExistingReservoir r : existing_reservoirs) {
         RoughBfieldReservoir reservoir = existing_reservoir_to_rough_reservoir(r);
         reservoir.pit = (search_config.search_type == SearchType::BULK_PIT ||
                          search_config.search_type == SearchType::SINGLE_PIT);
-        write_rough_reservoir_csv(csv_file, reservoir);
-        write_rough_reservoir_data(csv_data_file, &reservoir);
+        write_rough_reservoir_csv(csv, reservoir);
+        write_rough_reservoir_data(csv_data, &reservoir);
       }
     }
 
+    csv.flush();
+    csv_data.flush();
+    count_file_written(csv_file);
+    count_file_written(csv_data_file);
     fclose(csv_file);
     fclose(csv_data_file);
+    search_config.logger.flush();
     printf(convert_string("Screening finished for " + search_config.filename() +
                           ". Runtime: %.2f sec\n"),
            1.0e-6 * (walltime_usec() - start_usec));
   }
+  write_metrics("screening");
+  return 0;
 }
@@ -1,10 +1,44 @@
 #include "search_config.hpp"
 #include <algorithm>
+#include <vector>
 
-SearchConfig search_config;
+thread_local SearchConfig search_config;
 
 string format_for_filename(string s){
 	replace(s.begin(), s.end(), ' ' , '_');
 	s.erase(remove(s.begin(), s.end(), '"'), s.end());
 	return s;
 }
+
+// Builds the configuration from a line of the tasks file, splitting it into arguments the same way
+// the shell does for ./bin/<process> <task> (quoted reservoir names stay a single argument)
+SearchConfig::SearchConfig(const std::string &task) : SearchConfig() {
+	std::vector<std::string> args = {"search_driver"};
+	std::string arg;
+	bool quoted = false;
+	bool started = false;
+	for (char c : task) {
+		if (c == '"') {
+			quoted = !quoted;
+			started = true;
+		} else if (isspace(c) && !quoted) {
+			if (started)
+				args.push_back(arg);
+			arg.clear();
+			started = false;
+		} else {
+			arg += c;
+			started = true;
+		}
+	}
+	if (started)
+		args.push_back(arg);
+	if (args.size() < 2)
+		throw(1);
+
+	std::vector<char *> argv;
+	for (std::string &a : args)
+		argv.push_back(a.data());
+	argv.push_back(NULL);
+	*this = SearchConfig(args.size(), argv.data());
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include "coordinates.h"
+#include "logging.hpp"
 
 
 class SearchType {
@@ -59,10 +60,12 @@ class SearchType {
     type value;
 };
 
+// Messages are tagged with the grid square or reservoir and the stage, and are written to stdout
+// by a background thread (see logging.hpp). Arguments are only formatted if the level is enabled.
 class Logger {
   public:
     enum level {DEBUG, ERROR};
-    constexpr Logger(level logging_level) : logging_level(logging_level){}
+    Logger(level logging_level) : logging_level(logging_level){}
     Logger(char* c){
       if (atoi(c))
         logging_level = DEBUG;
@@ -71,25 +74,54 @@ class Logger {
     }
     constexpr operator level() const { return logging_level; }
 
-    void error(std::string message){
-      std::cout << message << std::endl;
+    // Changes the level, keeping the tags
+    Logger &operator=(level l){
+      logging_level = l;
+      return *this;
+    }
+
+    void set_cell(std::string c){
+      cell = c;
+    }
+    void set_stage(std::string s){
+      stage = s;
+    }
+
+    // Errors are written before returning
+    template <typename... Args> void error(const Args &...args){
+      log_message(tag(), format_log_message(args...), true);
+    }
+
+    // Writes out the queued messages, so they come before what the caller prints next
+    void flush(){
+      flush_log();
     }
 
     bool output_debug(){
       return logging_level == DEBUG;
     }
 
-    void debug(std::string message){
+    template <typename... Args> void debug(const Args &...args){
       if (this->output_debug())
-        std::cout << message << std::endl;
+        log_message(tag(), format_log_message(args...), false);
     }
-    void warning(std::string message){
+    template <typename... Args> void warning(const Args &...args){
       if (this->output_debug())
-        std::cout << message << std::endl;
+        log_message(tag(), format_log_message(args...), false);
     }
 
   private:
     level logging_level = DEBUG;
+    std::string cell;
+    std::string stage;
+
+    std::string tag(){
+      if (stage.empty())
+        return cell;
+      if (cell.empty())
+        return stage;
+      return cell + " " + stage;
+    }
 };
 
 string format_for_filename(string s);
@@ -102,6 +134,7 @@ class SearchConfig {
     Logger logger;
 
     SearchConfig() : search_type(SearchType::GREENFIELD), logger(Logger::ERROR){}
+    SearchConfig(const std::string &task);
     SearchConfig(int nargs, char **argv) : search_type(SearchType::GREENFIELD), logger(Logger::ERROR) {
       std::string arg1(argv[1]);
       int adj = 0;
@@ -146,6 +179,7 @@ class SearchConfig {
             logger = Logger(argv[2 + adj]);
         }
       }
+      logger.set_cell(filename());
     }
 
     std::string filename(){
@@ -155,6 +189,6 @@ class SearchConfig {
     }
 };
 
-extern SearchConfig search_config;
+extern thread_local SearchConfig search_config;
 
 #endif
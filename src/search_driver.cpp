@@ -1,7 +1,10 @@
 #include <fcntl.h>
 #include <dirent.h>
+#include <utime.h>
 
 #include "phes_base.h"
+#include "scheduler.hpp"
+#include "driver_journal.hpp"
 #include "boost/filesystem.hpp"
 namespace fs = boost::filesystem;
 
@@ -51,54 +54,231 @@ bool all_done(string process)
     return true;
 }
 
-// Reads a list of cells to process from the tasks_file (Eg. 148 -36)
-vector<string> read_tasklist(char *tasks_file)
-{
-	ifstream fd(tasks_file);
-	if (!fd)  {
-		fprintf(stderr, "failed to open task file %s: %s\n", tasks_file, strerror(errno));
-		exit(1);
+string task_lockfile(string process, string task){
+	return file_storage_location+"driver_files/lockfiles/"+journal_key(process, task);
+}
+
+// Claims a task for this driver by creating its lockfile, returning false if another driver has
+// already claimed it
+bool claim_task(int id, string process, string task){
+	mkdir(convert_string(file_storage_location+"driver_files/lockfiles"), 0770);
+	string tasklockfile = task_lockfile(process, task);
+	int fds = open(convert_string(tasklockfile), O_CREAT | O_EXCL | O_WRONLY, 0600);
+	if (fds < 0) {
+		if (errno == EEXIST) {
+			return false;
+		} else {
+			fprintf(stderr, "failed to to open lock file %s: %s\n", convert_string(tasklockfile), strerror(errno));
+			write_to_logfile(id, process, "Failed to open lock file "+tasklockfile+"\n");
+			exit(1);
+		}
 	}
-	vector<string> tasklist;
-	string line;
-	while(getline(fd, line)){
-		line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-		line.erase(remove(line.begin(), line.end(), '\r'), line.end());
-		tasklist.push_back(line);
+	close(fds);
+	write_journal_entry("claimed", process, task, id);
+	return true;
+}
+
+// Runs ./bin/<process> <task>, retrying up to 5 times
+bool run_command(int id, string process, string task){
+	for(int i = 0; i<5; i++){
+		if(!system(convert_string("./bin/"+process+" "+task)))
+			return true;
+		cout<<"Retrying command: ./bin/"+process+" "+task+"\n";
+		write_to_logfile(id, process, "Retrying command: ./bin/"+process+" "+task+"\n");
+		sleep(100);
 	}
-	printf("read %zu tasks\n", tasklist.size());
-	fd.close();
-	return tasklist;
+	cout<<"Problem running command: ./bin/"+process+" "+task+"\n";
+	write_to_logfile(id, process, "Problem running command: ./bin/"+process+" "+task+"\n");
+	return false;
 }
 
-// Reads a list of processes to complete from the processes_file (Eg. screening)
-vector<string> read_processlist(char *processes_file)
-{
-	ifstream fd(processes_file);
-	if (!fd)  {
-		fprintf(stderr, "failed to open process file %s: %s\n", processes_file, strerror(errno));
-		exit(1);
+// How often a driver touches the lockfile of the task it is running, and how long a lockfile can go
+// untouched before other drivers take the driver that claimed it to have stopped
+const int heartbeat_seconds = 60;
+const int stale_claim_seconds = 15*60;
+
+// Touches a lockfile every heartbeat_seconds until destroyed
+class ClaimHeartbeat {
+public:
+	ClaimHeartbeat(string lockfile) : lockfile(lockfile), beat_thread([this]{ beat(); }) {}
+	~ClaimHeartbeat(){
+		{
+			lock_guard<mutex> guard(lock);
+			stopped = true;
+		}
+		wake.notify_all();
+		beat_thread.join();
 	}
-	vector<string> processlist;
-	string line;
-	while(getline(fd, line)){
-		line.erase(remove(line.begin(), line.end(), '\n'), line.end());
-		line.erase(remove(line.begin(), line.end(), '\r'), line.end());
-		processlist.push_back(line);
+
+private:
+	void beat(){
+		unique_lock<mutex> guard(lock);
+		while (!wake.wait_for(guard, chrono::seconds(heartbeat_seconds), [this]{ return stopped; }))
+			utime(lockfile.c_str(), NULL);
+	}
+
+	string lockfile;
+	mutex lock;
+	condition_variable wake;
+	bool stopped = false;
+	thread beat_thread;
+};
+
+// Runs a claimed task, recording its runtime and outputs in the journal
+bool run_task(int id, string process, string task){
+	ClaimHeartbeat heartbeat(task_lockfile(process, task));
+	write_journal_entry("running", process, task, id);
+	unsigned long t_usec = walltime_usec();
+	bool success = run_command(id, process, task);
+	write_journal_entry(success ? "succeeded" : "failed", process, task, id,
+	                    1.0e-6*(walltime_usec() - t_usec), find_task_outputs(process, task));
+	return success;
+}
+
+string done_marker(string process, string task){
+	return file_storage_location+"driver_files/done/"+journal_key(process, task);
+}
+
+// Names of the done markers, read with a single listing of driver_files/done
+set<string> list_done_markers(){
+	set<string> markers;
+	DIR *dir = opendir(convert_string(file_storage_location+"driver_files/done"));
+	if (dir == NULL)
+		return markers;
+	while (struct dirent *entry = readdir(dir))
+		markers.insert(entry->d_name);
+	closedir(dir);
+	return markers;
+}
+
+bool claim_is_stale(string lockfile){
+	struct stat buffer;
+	return stat(lockfile.c_str(), &buffer) == 0 && time(NULL) - buffer.st_mtime >= stale_claim_seconds;
+}
+
+// Claims a task whose lockfile has not been touched for stale_claim_seconds, as the driver running it
+// has stopped. The lockfile is first renamed away, so only one driver can take it over.
+bool reclaim_stale_task(int id, string process, string task){
+	string lockfile = task_lockfile(process, task);
+	if (!claim_is_stale(lockfile))
+		return false;
+	string stale_lockfile = lockfile+".stale_"+to_string(id);
+	if (rename(lockfile.c_str(), stale_lockfile.c_str()))
+		return false;
+	// Another driver may have reclaimed the task between checking and renaming the lockfile
+	if (!claim_is_stale(stale_lockfile)) {
+		rename(stale_lockfile.c_str(), lockfile.c_str());
+		return false;
 	}
-	printf("read %zu processes\n", processlist.size());
-	fd.close();
-	return processlist;
+	remove(stale_lockfile.c_str());
+	write_to_logfile(id, "dag", "Reclaiming stale task "+process+" "+task+"\n");
+	return claim_task(id, process, task);
 }
 
-void write_to_logfile(int id, string process, string message){
-	ofstream logfile;
-  	logfile.open(file_storage_location+"debug1/"+process+"_logfiles/"+process+"_"+to_string(id), ios_base::app);
-  	logfile<<message;
-  	logfile.close();
+// Prepares driver_files for restarting an interrupted run. Tasks the journal records as succeeded
+// with unchanged outputs keep their lockfiles and done markers so no driver runs them again. The
+// lockfiles and done markers of all other tasks are removed, along with the worker directories of
+// the drivers that were running.
+void resume_run(vector<string> &tasklist, vector<string> &processlist){
+	vector<DriverTask> graph = build_task_graph(tasklist, processlist);
+	int complete_count = mark_complete_tasks(graph);
+	int stale_count = 0;
+	mkdir(convert_string(file_storage_location+"driver_files"), 0770);
+	mkdir(convert_string(file_storage_location+"driver_files/lockfiles"), 0770);
+	mkdir(convert_string(file_storage_location+"driver_files/done"), 0770);
+	for (DriverTask &driver_task : graph) {
+		string lockfile = task_lockfile(driver_task.process, driver_task.task);
+		string marker = done_marker(driver_task.process, driver_task.task);
+		if (driver_task.complete) {
+			close(open(convert_string(lockfile), O_CREAT | O_WRONLY, 0600));
+			close(open(convert_string(marker), O_CREAT | O_WRONLY, 0600));
+		} else {
+			if (!remove(convert_string(lockfile)))
+				stale_count++;
+			remove(convert_string(marker));
+		}
+	}
+	fs::path p(file_storage_location+"driver_files/");
+	for (fs::directory_iterator it(p); it != fs::directory_iterator(); it++) {
+		string name = it->path().filename().string();
+		if (name.size() > 8 && name.compare(name.size()-8, 8, "_workers") == 0)
+			fs::remove_all(it->path());
+	}
+	printf("%d of %zu tasks complete, removed %d stale lockfiles\n", complete_count, graph.size(), stale_count);
 }
 
-int main()
+// Runs tasks as soon as their dependencies have finished, rather than waiting for every driver to
+// finish each process. Drivers still claim tasks through lockfiles, and mark finished tasks with a
+// file in driver_files/done so other drivers can release their dependents. Each pass reads the done
+// markers once and runs every ready task this driver can claim. Drivers with nothing to run take
+// over tasks whose lockfiles have gone stale.
+void run_dag(vector<string> &tasklist, vector<string> &processlist, TaskCostModel *cost_model){
+	mkdir(convert_string(file_storage_location+"debug1"), 0770);
+	mkdir(convert_string(file_storage_location+"driver_files"), 0770);
+	mkdir(convert_string(file_storage_location+"driver_files/done"), 0770);
+	int id = set_worker("dag");
+	mkdir(convert_string(file_storage_location+"debug1/dag_logfiles"), 0770);
+	for (auto process : processlist)
+		mkdir(convert_string(file_storage_location+"debug1/"+process+"_logfiles"), 0770);
+
+	vector<DriverTask> graph = build_task_graph(tasklist, processlist);
+	vector<bool> claimed(graph.size(), false);
+	vector<bool> done(graph.size(), false);
+	uint done_count = 0;
+	auto run_claimed = [&](int i){
+		run_task(id, graph[i].process, graph[i].task);
+		int fds = open(convert_string(done_marker(graph[i].process, graph[i].task)), O_CREAT | O_WRONLY, 0600);
+		close(fds);
+		done[i] = true;
+		done_count++;
+	};
+	while (done_count < graph.size()) {
+		set<string> done_markers = list_done_markers();
+		for (uint i = 0; i < graph.size(); i++) {
+			if (!done[i] && done_markers.count(journal_key(graph[i].process, graph[i].task))) {
+				done[i] = true;
+				done_count++;
+			}
+		}
+		vector<int> ready_tasks;
+		for (uint i = 0; i < graph.size(); i++) {
+			if (claimed[i] || done[i])
+				continue;
+			bool ready = true;
+			for (int dependency : graph[i].dependencies)
+				ready = ready && done[dependency];
+			if (ready)
+				ready_tasks.push_back(i);
+		}
+		if (cost_model != NULL)
+			cost_model->sort_longest_first(graph, ready_tasks);
+		bool ran_task = false;
+		for (int i : ready_tasks) {
+			claimed[i] = true;
+			if (!claim_task(id, graph[i].process, graph[i].task))
+				continue;
+			run_claimed(i);
+			ran_task = true;
+		}
+		if (ran_task || done_count == graph.size())
+			continue;
+		// Tasks claimed by other drivers that have not finished. The done markers are read again after
+		// running one, as other tasks may have finished meanwhile.
+		for (uint i = 0; i < graph.size(); i++) {
+			if (claimed[i] && !done[i] && reclaim_stale_task(id, graph[i].process, graph[i].task)) {
+				run_claimed(i);
+				ran_task = true;
+				break;
+			}
+		}
+		if (!ran_task)
+			sleep(10);
+	}
+	unset_worker(id, "dag");
+	write_to_logfile(id, "dag", "Done\n");
+}
+
+int main(int nargs, char **argv)
 {
 	parse_variables(convert_string("storage_location"));
 	parse_variables(convert_string(file_storage_location+"variables"));
@@ -106,43 +286,60 @@ int main()
 	vector<string> tasklist = read_tasklist(convert_string(file_storage_location+tasks_file));
 	vector<string> processlist = read_processlist(convert_string(file_storage_location+processes_file));
 
+	if (nargs > 1 && string(argv[1]) == "resume") {
+		resume_run(tasklist, processlist);
+		return 0;
+	}
+
+	if (driver_threads > 0) {
+		// Run every process within this driver on a pool of threads, starting each task as soon as
+		// the tasks it depends on have finished instead of waiting for the whole process to finish
+		GDALAllRegister();
+		vector<DriverTask> graph = build_task_graph(tasklist, processlist);
+		int complete_count = mark_complete_tasks(graph);
+		if (complete_count > 0)
+			printf("Skipping %d tasks completed by an earlier run\n", complete_count);
+		unique_ptr<TaskCostModel> cost_model;
+		if (longest_first)
+			cost_model.reset(new TaskCostModel());
+		WorkStealingScheduler scheduler(graph, driver_threads, cost_model.get());
+		scheduler.run();
+		printf("Done\n");
+		return 0;
+	}
+
+	unique_ptr<TaskCostModel> cost_model;
+	if (longest_first) {
+		GDALAllRegister();
+		cost_model.reset(new TaskCostModel());
+	}
+
+	if (driver_dag) {
+		run_dag(tasklist, processlist, cost_model.get());
+		printf("Done\n");
+		return 0;
+	}
+
 	for (auto process : processlist) {
 		mkdir(convert_string(file_storage_location+"debug1"), 0770);
 		mkdir(convert_string(file_storage_location+"driver_files"), 0770);
 		int id = set_worker(process);
 		mkdir(convert_string(file_storage_location+"debug1/"+process+"_logfiles"), 0770);
 
-		for(auto task : tasklist){
-			mkdir(convert_string(file_storage_location+"driver_files/lockfiles"), 0770);
-			string tasklockfile = file_storage_location+"driver_files/lockfiles/"+process+"_task_"+format_for_filename(task);
-			int fds = open(convert_string(tasklockfile), O_CREAT | O_EXCL | O_WRONLY, 0600);
-			if (fds < 0) {
-                if (errno == EEXIST) {
-					continue;
-	            } else {
-					fprintf(stderr, "failed to to open lock file %s: %s\n", convert_string(tasklockfile), strerror(errno));
-					write_to_logfile(id, process, "Failed to open lock file "+tasklockfile+"\n");
-					exit(1);
-				}
-			}
-			close(fds);
-			bool success = false;
-			for(int i = 0; i<5; i++){
-				if(!system(convert_string("./bin/"+process+" "+task))){
-					success = true;
-					break;
-				}else{
-					cout<<"Retrying command: ./bin/"+process+" "+task+"\n";
-					write_to_logfile(id, process, "Retrying command: ./bin/"+process+" "+task+"\n");
-					sleep(100);
-				}
-			}
-			if(!success){
-				cout<<"Problem running command: ./bin/"+process+" "+task+"\n";
-				write_to_logfile(id, process, "Problem running command: ./bin/"+process+" "+task+"\n");
-				// exit(1);
-			}
-
+		vector<DriverTask> tasks;
+		vector<int> order;
+		for (auto task : tasklist) {
+			DriverTask driver_task;
+			driver_task.process = process;
+			driver_task.task = task;
+			order.push_back(tasks.size());
+			tasks.push_back(driver_task);
+		}
+		if (cost_model)
+			cost_model->sort_longest_first(tasks, order);
+		for (int i : order) {
+			if (claim_task(id, process, tasks[i].task))
+				run_task(id, process, tasks[i].task);
 		}
 		unset_worker(id, process);
 		write_to_logfile(id, process, "Done\n");
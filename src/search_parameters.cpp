@@ -0,0 +1,58 @@
+#include "phes_base.h"
+
+SearchParameters SearchParameters::from_variables() {
+  SearchParameters p;
+  p.border = ::border;
+  p.dambatter = ::dambatter;
+  p.cwidth = ::cwidth;
+  p.freeboard = ::freeboard;
+  p.use_tiled_bluefield = ::use_tiled_bluefield;
+  p.use_tiled_rivers = ::use_tiled_rivers;
+
+  p.stream_threshold = ::stream_threshold;
+  p.contour_height = ::contour_height;
+  p.min_reservoir_volume = ::min_reservoir_volume;
+  p.min_reservoir_water_rock = ::min_reservoir_water_rock;
+  p.min_max_dam_height = ::min_max_dam_height;
+  p.filter_filenames = ::filter_filenames;
+  p.dam_wall_heights = ::dam_wall_heights;
+  p.max_wall_height = ::max_wall_height;
+
+  p.min_head = ::min_head;
+  p.max_head = ::max_head;
+  p.min_pair_water_rock = ::min_pair_water_rock;
+  p.min_slope = ::min_slope;
+  p.min_pp_slope = ::min_pp_slope;
+  p.max_lowers_per_upper = ::max_lowers_per_upper;
+  p.tolerance_on_FOM = ::tolerance_on_FOM;
+  p.max_head_variability = ::max_head_variability;
+  p.pit_height_resolution = ::pit_height_resolution;
+  p.max_bluefield_surface_area_ratio = ::max_bluefield_surface_area_ratio;
+  p.tests = ::tests;
+  p.category_cutoffs = ::category_cutoffs;
+
+  p.gravity = ::gravity;
+  p.generation_efficiency = ::generation_efficiency;
+  p.usable_volume = ::usable_volume;
+  p.water_density = ::water_density;
+
+  p.volume_accuracy = ::volume_accuracy;
+  p.dam_wall_height_resolution = ::dam_wall_height_resolution;
+  p.minimum_dam_height = ::minimum_dam_height;
+
+  p.powerhouse_coeff = ::powerhouse_coeff;
+  p.power_exp = ::power_exp;
+  p.head_exp = ::head_exp;
+  p.power_slope_factor = ::power_slope_factor;
+  p.slope_int = ::slope_int;
+  p.head_coeff = ::head_coeff;
+  p.power_offset = ::power_offset;
+  p.tunnel_fixed = ::tunnel_fixed;
+  p.dam_cost = ::dam_cost;
+  p.lining_cost = ::lining_cost;
+  p.sea_power_scaling = ::sea_power_scaling;
+  p.ref_marine_cost = ::ref_marine_cost;
+  p.ref_power = ::ref_power;
+  p.ref_head = ::ref_head;
+  return p;
+}
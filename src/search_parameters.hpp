@@ -0,0 +1,73 @@
+#ifndef SEARCH_PARAMETERS_H
+#define SEARCH_PARAMETERS_H
+
+// Included from phes_base.h once Test and CategoryCutoff are defined
+
+// The settings used by screening, pairing, pretty_set and constructor. The stages take these as
+// a const reference rather than reading the globals set by parse_variables, so grid squares with
+// different settings can be run in one process. The globals are kept for the other programs.
+struct SearchParameters {
+  // General
+  int border;
+  double dambatter;
+  double cwidth;
+  double freeboard;
+  bool use_tiled_bluefield;
+  bool use_tiled_rivers;
+
+  // Screening
+  int stream_threshold;
+  int contour_height;
+  double min_reservoir_volume;
+  double min_reservoir_water_rock;
+  double min_max_dam_height;
+  vector<string> filter_filenames;
+  vector<double> dam_wall_heights;
+  int max_wall_height;
+
+  // Pairing
+  int min_head;
+  int max_head;
+  double min_pair_water_rock;
+  double min_slope;
+  double min_pp_slope;
+  int max_lowers_per_upper;
+  double tolerance_on_FOM;
+  double max_head_variability;
+  int pit_height_resolution;
+  double max_bluefield_surface_area_ratio;
+  vector<Test> tests;
+  vector<CategoryCutoff> category_cutoffs;
+
+  // Common
+  double gravity;
+  double generation_efficiency;
+  double usable_volume;
+  double water_density;
+
+  // Constructor
+  double volume_accuracy;
+  double dam_wall_height_resolution;
+  double minimum_dam_height;
+
+  // FOM Calculations
+  double powerhouse_coeff;
+  double power_exp;
+  double head_exp;
+  double power_slope_factor;
+  double slope_int;
+  double head_coeff;
+  double power_offset;
+  double tunnel_fixed;
+  double dam_cost;
+  double lining_cost;
+  double sea_power_scaling;
+  double ref_marine_cost;
+  double ref_power;
+  double ref_head;
+
+  // Copies the values set by parse_variables
+  static SearchParameters from_variables();
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef STAGES_H
+#define STAGES_H
+
+#include "phes_base.h"
+
+// Each stage runs for the task described by the thread's search_config, assuming GDAL drivers are
+// registered and the variables have been parsed. Stages throw on failure rather than exiting so
+// they can be run from search_driver's worker threads as well as from their own executables.
+int run_screening();
+int run_pairing();
+int run_pretty_set();
+int run_constructor();
+
+typedef int (*StageFunction)();
+
+// Returns the stage with the given process name, or NULL if it has no in-process implementation
+StageFunction find_stage(string process);
+
+// The stages without their file input and output, used by phes_cell to run a grid square without
+// going through processing_files. Results handed from one stage to the next should go through
+// round_trip_rough_reservoirs or round_trip_rough_pairs to match the separate executables. The
+// settings come from params rather than the globals set by parse_variables.
+
+struct ScreeningResult {
+  Model<char> *flow_directions; // Owned by the caller
+  vector<unique_ptr<RoughReservoir>> reservoirs;
+};
+
+// Screens a greenfield or ocean grid square, depending on search_config.search_type
+ScreeningResult screen_grid_square(GridSquare square, const SearchParameters &params);
+
+// Passes the pairs found for each upper reservoir to found as soon as that upper has been paired,
+// in the order pairing writes them, and counts them by test in pairs
+void pairing(vector<unique_ptr<RoughReservoir>> &upper_reservoirs,
+             vector<unique_ptr<RoughReservoir>> &lower_reservoirs,
+             const function<void(Pair &)> &found, vector<int> &pairs,
+             bool existing_existing_allowed,
+             const SearchParameters &params);
+
+// Returns the non-overlapping pairs for each test in turn. Sorts each test's pairs.
+vector<Pair> select_pretty_set(vector<vector<Pair>> &pairs, BigModel &big_model,
+                               const SearchParameters &params);
+
+// Writes the final outputs for the pairs of each test. Reads the BigModel for
+// search_config.grid_square if big_model is NULL.
+int construct_pairs(vector<vector<Pair>> &pairs, BigModel *big_model,
+                    const SearchParameters &params);
+
+#endif
@@ -0,0 +1,111 @@
+#include "synthetic_dem.hpp"
+
+static const char *WGS84_WKT =
+    "GEOGCS[\"WGS 84\",DATUM[\"WGS_1984\",SPHEROID[\"WGS 84\",6378137,298.257223563]],"
+    "PRIMEM[\"Greenwich\",0],UNIT[\"degree\",0.0174532925199433],AUTHORITY[\"EPSG\",\"4326\"]]";
+
+const int tile_size = 3601;
+const int octaves = 8;
+const double base_wavelength = 0.3; // Degrees
+
+static uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Uniform in [-1, 1) at an integer lattice point
+double SyntheticTerrain::lattice(int octave, long x, long y) const {
+  uint64_t h = splitmix64(seed ^ splitmix64((uint64_t)octave ^ splitmix64((uint64_t)x ^
+                                                                         splitmix64((uint64_t)y))));
+  return (h >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+double SyntheticTerrain::value_noise(int octave, double x, double y) const {
+  long x0 = (long)floor(x);
+  long y0 = (long)floor(y);
+  double fx = x - x0;
+  double fy = y - y0;
+  fx = fx * fx * (3 - 2 * fx);
+  fy = fy * fy * (3 - 2 * fy);
+  double top = lattice(octave, x0, y0) * (1 - fx) + lattice(octave, x0 + 1, y0) * fx;
+  double bottom = lattice(octave, x0, y0 + 1) * (1 - fx) + lattice(octave, x0 + 1, y0 + 1) * fx;
+  return top * (1 - fy) + bottom * fy;
+}
+
+double SyntheticTerrain::fractal_noise(double lat, double lon) const {
+  double total = 0;
+  double amplitude = 1;
+  double frequency = 1 / base_wavelength;
+  for (int octave = 0; octave < octaves; octave++) {
+    total += amplitude * value_noise(octave, lon * frequency, lat * frequency);
+    amplitude *= 0.5;
+    frequency *= 2;
+  }
+  return total;
+}
+
+short SyntheticTerrain::height(double lat, double lon) const {
+  // Position relative to the south-west corner of the centre grid square
+  double u = lon - centre.lon;
+  double v = lat - centre.lat;
+
+  // Ridged hills rising from the coast to the east
+  double noise = fractal_noise(lat, lon);
+  double h = 400 + 900 * noise + 500 * (1 - 2 * fabs(noise)) + 700 * (u + 0.5);
+
+  // River valleys meandering east-west
+  for (int r = 0; r < 2; r++) {
+    double centreline = 0.3 + 0.45 * r + 0.06 * sin(u * (9 + 4 * r) + r);
+    double d = (v - centreline) / 0.015;
+    h -= 350 * exp(-d * d);
+  }
+
+  // Flat plateau
+  double p = SQ(u - 1.4) + SQ(v + 0.4);
+  if (p < SQ(0.35))
+    h = MIN(h, 650.0);
+
+  if (h <= 0)
+    return 0;
+  return (short)MIN(h, 8000.0);
+}
+
+Model<short> *SyntheticTerrain::tile(GridSquare square) const {
+  Model<short> *DEM = new Model<short>(tile_size, tile_size, MODEL_UNSET);
+  Geodata geodata;
+  geodata.geotransform[0] = square.lon - 0.5 / 3600;
+  geodata.geotransform[1] = 1.0 / 3600;
+  geodata.geotransform[2] = 0;
+  geodata.geotransform[3] = square.lat + 1 + 0.5 / 3600;
+  geodata.geotransform[4] = 0;
+  geodata.geotransform[5] = -1.0 / 3600;
+  geodata.geoprojection = WGS84_WKT;
+  DEM->set_geodata(geodata);
+  for (int row = 0; row < tile_size; row++)
+    for (int col = 0; col < tile_size; col++) {
+      GeographicCoordinate point = DEM->get_coordinate(row, col);
+      DEM->set(row, col, height(point.lat, point.lon));
+    }
+  return DEM;
+}
+
+int write_synthetic_tiles(SyntheticTerrain &terrain, GridSquare centre, bool neighbors) {
+  mkdir(convert_string(file_storage_location + "input"), 0777);
+  mkdir(convert_string(file_storage_location + "input/DEMs"), 0777);
+  int radius = neighbors ? 1 : 0;
+  int written = 0;
+  for (int dlat = -radius; dlat <= radius; dlat++)
+    for (int dlon = -radius; dlon <= radius; dlon++) {
+      GridSquare square = GridSquare_init(centre.lat + dlat, centre.lon + dlon);
+      string filename = file_storage_location + "input/DEMs/" + str(square) + "_1arc_v3.tif";
+      if (file_exists(filename))
+        continue;
+      Model<short> *DEM = terrain.tile(square);
+      DEM->write(filename, GDT_Int16);
+      delete DEM;
+      written++;
+    }
+  return written;
+}
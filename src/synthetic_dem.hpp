@@ -0,0 +1,36 @@
+#ifndef SYNTHETIC_DEM_H
+#define SYNTHETIC_DEM_H
+
+#include "phes_base.h"
+
+// Deterministic terrain for benchmarking without the SRTM inputs. Heights are a function of the
+// seed, the centre grid square and the geographic coordinate, so the tiles around one centre join
+// up and a tile is the same whichever order the tiles are generated in. Tiles generated for
+// different centres do not match. Around the centre grid square the terrain has fractal hills and
+// ridges, two river valleys running east-west, ocean to the west and a flat plateau to the
+// south-east.
+class SyntheticTerrain {
+  public:
+    SyntheticTerrain(uint64_t seed, GridSquare centre) : seed(seed), centre(centre) {}
+
+    // Height (m) at a point, 0 for ocean
+    short height(double lat, double lon) const;
+
+    // A 3601 by 3601 tile laid out as an SRTM *_1arc_v3.tif
+    Model<short> *tile(GridSquare square) const;
+
+  private:
+    uint64_t seed;
+    GridSquare centre;
+
+    double lattice(int octave, long x, long y) const;
+    double value_noise(int octave, double x, double y) const;
+    double fractal_noise(double lat, double lon) const;
+};
+
+// Writes input/DEMs/<square>_1arc_v3.tif under file_storage_location for the grid square and, if
+// neighbors is set, its 8 neighbours, skipping tiles that already exist. Returns the number of
+// tiles written.
+int write_synthetic_tiles(SyntheticTerrain &terrain, GridSquare centre, bool neighbors = true);
+
+#endif
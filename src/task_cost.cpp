@@ -0,0 +1,98 @@
+#include "task_cost.hpp"
+#include "driver_journal.hpp"
+
+static double count_lines(string filename) {
+  ifstream file(filename);
+  if (!file)
+    return 0;
+  int count = -1;  // Header
+  string line;
+  while (getline(file, line))
+    count++;
+  return MAX(count, 0);
+}
+
+double estimate_task_size(string process, string task) {
+  SearchConfig config;
+  try {
+    config = SearchConfig(task);
+  } catch (int e) {
+    return 0;
+  }
+  string name = config.filename();
+  if (process == "screening") {
+    if (config.search_type.single())
+      return 0;
+    string filename = file_storage_location + "input/DEMs/" + str(config.grid_square) + "_1arc_v3.tif";
+    if (!file_exists(filename))
+      return 0;
+    GDALDataset *Dataset = (GDALDataset *)GDALOpen(filename.c_str(), GA_ReadOnly);
+    if (Dataset == NULL)
+      return 0;
+    double min_max[2] = {0, 0};
+    Dataset->GetRasterBand(1)->ComputeRasterMinMax(TRUE, min_max);
+    GDALClose((GDALDatasetH)Dataset);
+    return min_max[1] - min_max[0];
+  }
+  if (process == "pairing")
+    return count_lines(file_storage_location + "processing_files/reservoirs/" + name +
+                       "_reservoirs_data.csv");
+  if (process == "pretty_set")
+    return count_lines(file_storage_location + "processing_files/pairs/" + name +
+                       "_rough_pairs_data.csv");
+  if (process == "constructor")
+    return count_lines(file_storage_location + "processing_files/pretty_set_pairs/" + name +
+                       "_rough_pretty_set_pairs_data.csv");
+  return 0;
+}
+
+TaskCostModel::TaskCostModel() : runtimes(read_task_runtimes()) {}
+
+double TaskCostModel::task_size(DriverTask &driver_task) {
+  string key = journal_key(driver_task.process, driver_task.task);
+  {
+    lock_guard<mutex> lock(sizes_lock);
+    auto it = sizes.find(key);
+    if (it != sizes.end())
+      return it->second;
+  }
+  double size = estimate_task_size(driver_task.process, driver_task.task);
+  lock_guard<mutex> lock(sizes_lock);
+  sizes[key] = size;
+  return size;
+}
+
+void TaskCostModel::sort_longest_first(vector<DriverTask> &graph, vector<int> &tasks) {
+  map<string, double> total_runtime;
+  map<string, double> total_size;
+  vector<double> task_sizes;
+  for (int task : tasks) {
+    DriverTask &driver_task = graph[task];
+    task_sizes.push_back(task_size(driver_task));
+    auto it = runtimes.find(journal_key(driver_task.process, driver_task.task));
+    if (it != runtimes.end() && task_sizes.back() > 0) {
+      total_runtime[driver_task.process] += it->second;
+      total_size[driver_task.process] += task_sizes.back();
+    }
+  }
+
+  map<int, double> predicted;
+  map<string, int> process_order;
+  for (uint i = 0; i < tasks.size(); i++) {
+    DriverTask &driver_task = graph[tasks[i]];
+    process_order.insert({driver_task.process, process_order.size()});
+    auto it = runtimes.find(journal_key(driver_task.process, driver_task.task));
+    if (it != runtimes.end())
+      predicted[tasks[i]] = it->second;
+    else if (total_size[driver_task.process] > 0)
+      predicted[tasks[i]] =
+          task_sizes[i] * total_runtime[driver_task.process] / total_size[driver_task.process];
+    else
+      predicted[tasks[i]] = task_sizes[i];
+  }
+  stable_sort(tasks.begin(), tasks.end(), [&](int a, int b) {
+    if (graph[a].process != graph[b].process)
+      return process_order[graph[a].process] < process_order[graph[b].process];
+    return predicted[a] > predicted[b];
+  });
+}
@@ -0,0 +1,35 @@
+#ifndef TASK_COST_H
+#define TASK_COST_H
+
+#include "phes_base.h"
+#include "task_graph.hpp"
+
+// Cheap measure of how much work a task will be, used when it has no recorded runtime:
+//   screening   - elevation range (m) of the task's DEM
+//   pairing     - number of reservoirs found by screening the task
+//   pretty_set  - number of rough pairs found by pairing the task
+//   constructor - number of pairs kept by pretty_set for the task
+// Returns 0 if the input has not been written yet.
+double estimate_task_size(string process, string task);
+
+// Predicts task runtimes from the driver journal, falling back to estimate_task_size scaled by the
+// runtime per unit size of the tasks of the same process that have run before
+class TaskCostModel {
+  public:
+    TaskCostModel();
+
+    // Stable sorts the tasks of each process, longest predicted runtime first. Tasks of different
+    // processes keep the order in which the processes first appear.
+    void sort_longest_first(vector<DriverTask> &graph, vector<int> &tasks);
+
+  private:
+    double task_size(DriverTask &driver_task);
+
+    map<string, double> runtimes;
+    // Tasks are only sorted once their dependencies have finished, so their inputs are written and
+    // the sizes, including sizes of 0, can be cached
+    map<string, double> sizes;
+    mutex sizes_lock;
+};
+
+#endif
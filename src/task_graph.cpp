@@ -0,0 +1,116 @@
+#include "task_graph.hpp"
+#include "driver_journal.hpp"
+
+// Reads a list of cells to process from the tasks_file (Eg. 148 -36)
+vector<string> read_tasklist(char *tasks_file)
+{
+	ifstream fd(tasks_file);
+	if (!fd)  {
+		fprintf(stderr, "failed to open task file %s: %s\n", tasks_file, strerror(errno));
+		exit(1);
+	}
+	vector<string> tasklist;
+	string line;
+	while(getline(fd, line)){
+		line.erase(remove(line.begin(), line.end(), '\n'), line.end());
+		line.erase(remove(line.begin(), line.end(), '\r'), line.end());
+		tasklist.push_back(line);
+	}
+	printf("read %zu tasks\n", tasklist.size());
+	fd.close();
+	return tasklist;
+}
+
+// Reads a list of processes to complete from the processes_file (Eg. screening)
+vector<string> read_processlist(char *processes_file)
+{
+	ifstream fd(processes_file);
+	if (!fd)  {
+		fprintf(stderr, "failed to open process file %s: %s\n", processes_file, strerror(errno));
+		exit(1);
+	}
+	vector<string> processlist;
+	string line;
+	while(getline(fd, line)){
+		line.erase(remove(line.begin(), line.end(), '\n'), line.end());
+		line.erase(remove(line.begin(), line.end(), '\r'), line.end());
+		processlist.push_back(line);
+	}
+	printf("read %zu processes\n", processlist.size());
+	fd.close();
+	return processlist;
+}
+
+// Finds the grid square a task runs on. Returns false if the grid square of an existing reservoir
+// cannot be found in the existing reservoirs file.
+bool task_grid_square(string task, GridSquare &grid_square) {
+  SearchConfig config;
+  try {
+    config = SearchConfig(task);
+    if (config.search_type.single())
+      config.grid_square = get_square_coordinate(get_existing_reservoir(config.name));
+  } catch (int e) {
+    return false;
+  } catch (exception &e) {
+    return false;
+  }
+  grid_square = config.grid_square;
+  return true;
+}
+
+vector<DriverTask> build_task_graph(vector<string> &tasklist, vector<string> &processlist) {
+  vector<DriverTask> graph;
+  int ntasks = tasklist.size();
+  for (string process : processlist)
+    for (string task : tasklist)
+      graph.push_back({process, task, {}, {}});
+
+  vector<bool> known_square(ntasks, false);
+  vector<GridSquare> squares(ntasks);
+  map<pair<int, int>, vector<int>> tasks_in_square;
+  for (int t = 0; t < ntasks; t++) {
+    known_square[t] = task_grid_square(tasklist[t], squares[t]);
+    if (known_square[t])
+      tasks_in_square[{squares[t].lat, squares[t].lon}].push_back(t);
+  }
+
+  for (uint p = 1; p < processlist.size(); p++) {
+    bool reads_neighbours = processlist[p] == "pairing" && processlist[p - 1] == "screening";
+    for (int t = 0; t < ntasks; t++) {
+      DriverTask &driver_task = graph[p * ntasks + t];
+      set<int> dependencies = {t};
+      if (reads_neighbours && !known_square[t]) {
+        search_config.logger.debug("Could not find grid square of " + tasklist[t] +
+                                   ", waiting for all screening tasks");
+        for (int u = 0; u < ntasks; u++)
+          dependencies.insert(u);
+      } else if (reads_neighbours) {
+        for (int dlat = -1; dlat <= 1; dlat++)
+          for (int dlon = -1; dlon <= 1; dlon++) {
+            auto it = tasks_in_square.find({squares[t].lat + dlat, squares[t].lon + dlon});
+            if (it != tasks_in_square.end())
+              dependencies.insert(it->second.begin(), it->second.end());
+          }
+      }
+      for (int u : dependencies) {
+        driver_task.dependencies.push_back((p - 1) * ntasks + u);
+        graph[(p - 1) * ntasks + u].dependents.push_back(p * ntasks + t);
+      }
+    }
+  }
+  return graph;
+}
+
+int mark_complete_tasks(vector<DriverTask> &graph) {
+  map<string, JournalEntry> journal = read_journal();
+  int count = 0;
+  // Dependencies always come before their dependents in the graph
+  for (DriverTask &driver_task : graph) {
+    driver_task.complete = task_succeeded(journal, driver_task.process, driver_task.task);
+    for (int dependency : driver_task.dependencies)
+      driver_task.complete = driver_task.complete && graph[dependency].complete;
+    if (driver_task.complete)
+      count++;
+  }
+  return count;
+}
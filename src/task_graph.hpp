@@ -0,0 +1,30 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "phes_base.h"
+
+// One process run for one line of the tasks file (Eg. pairing for 148 -36)
+struct DriverTask {
+  string process;
+  string task;
+  vector<int> dependencies;  // Indices of tasks that must finish before this one can start
+  vector<int> dependents;    // Indices of tasks waiting on this one
+  bool complete = false;     // Already completed by an earlier run
+};
+
+vector<string> read_tasklist(char *tasks_file);
+vector<string> read_processlist(char *processes_file);
+
+bool task_grid_square(string task, GridSquare &grid_square);
+
+// Builds the dependency graph for running every process on every task. Tasks are ordered process
+// by process, in the order of the processes and tasks files. Pairing waits for screening of the
+// task and every task within the surrounding 3x3 grid squares (it reads the lowers of the 8
+// neighbours), other processes wait for the previous process on the same task.
+vector<DriverTask> build_task_graph(vector<string> &tasklist, vector<string> &processlist);
+
+// Marks the tasks the journal records as succeeded with unchanged outputs as complete. Tasks that
+// depend on an incomplete task are run again, since their inputs will be rewritten.
+int mark_complete_tasks(vector<DriverTask> &graph);
+
+#endif
@@ -8,6 +8,10 @@ string existing_reservoirs_shp;
 string existing_reservoirs_shp_names;
 bool use_tiled_bluefield;
 bool use_tiled_rivers;
+int driver_threads = 0;				// Worker threads for the in-process scheduler (0 uses lockfiles and ./bin/<process>)
+bool driver_dag = false;			// Start each task once its dependencies are done instead of waiting for each process to finish
+bool longest_first = false;			// Run the tasks with the longest predicted runtime first instead of in file order
+int stage_threads = 1;				// Threads used within pretty_set and the constructor for each task
 
 // General
 string file_storage_location;		// Where to look for input files and store output files
@@ -241,6 +245,14 @@ void parse_variables(char* filename){
 				use_tiled_bluefield = stoi(value);
 			if(variable=="use_tiled_rivers")
 				use_tiled_rivers = stoi(value);
+			if(variable=="driver_threads")
+				driver_threads = stoi(value);
+			if(variable=="driver_dag")
+				driver_dag = stoi(value);
+			if(variable=="longest_first")
+				longest_first = stoi(value);
+			if(variable=="stage_threads")
+				stage_threads = stoi(value);
 		}
 	}
 }